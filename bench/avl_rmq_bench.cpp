@@ -0,0 +1,489 @@
+////////////////////////////////////////////////////////////////////////////////
+// avl_rmq_bench.cpp
+//   Benchmark the dynamic rmq data structures.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Massimiliano Rossi
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+/*!
+   \file avl_rmq_bench.cpp
+   \brief avl_rmq_bench.cpp Benchmark the dynamic rmq data structures.
+   \author Massimiliano Rossi
+   \date 20/10/2021
+*/
+
+#include <random>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <cstdint>
+#include <benchmark/benchmark.h>
+#include <avl_rmq.hpp>
+#include <compact_avl_rmq.hpp>
+#include <btree_rmq.hpp>
+#include <bucket_avl_rmq.hpp>
+#include <sliding_window_rmq.hpp>
+#include <async_rmq.hpp>
+#include <malloc_count.h>
+
+#ifndef DYNAMIC_RMQ_BENCH_MAX_LOG
+#define DYNAMIC_RMQ_BENCH_MAX_LOG 22
+#endif
+
+// Distributions of the ranks of the insertions.
+enum rank_dist { RANDOM = 0, SEQUENTIAL = 1, SKEWED = 2 };
+
+static const size_t n_queries = 1 << 16;
+
+/*!
+ * Draws the rank of the next insertion in an array of size n.
+ */
+template< typename K>
+static inline K next_rank(std::mt19937_64& gen, size_t n, int dist)
+{
+    switch(dist)
+    {
+    case SEQUENTIAL:
+        return static_cast<K>(n);
+    case SKEWED:
+    {
+        // Most of the insertions are close to the beginning of the array.
+        const double u = std::generate_canonical<double, 32>(gen);
+        return static_cast<K>(static_cast<double>(n) * u * u * u * u);
+    }
+    default:
+        return static_cast<K>(gen() % (n + 1));
+    }
+}
+
+/*!
+ * Fill the structure with n random values inserted with the given
+ * distribution of ranks.
+ */
+template< typename T, typename K, typename S>
+static void fill(T& rmq, size_t n, int dist, uint64_t seed = 42)
+{
+    std::mt19937_64 gen(seed);
+    for(size_t i = 0; i < n; ++i)
+        rmq.insert(next_rank<K>(gen, i, dist), static_cast<S>(gen()));
+}
+
+/*!
+ * Generate random intervals of width at most width in an array of size n.
+ */
+template< typename K>
+static std::vector< std::pair<K,K> > random_ranges(size_t n, size_t width, uint64_t seed = 43)
+{
+    std::mt19937_64 gen(seed);
+    std::vector< std::pair<K,K> > ranges(n_queries);
+    if(width > n)
+        width = n;
+    for(size_t i = 0; i < n_queries; ++i)
+    {
+        const size_t left = gen() % (n - width + 1);
+        ranges[i] = std::make_pair(static_cast<K>(left), static_cast<K>(left + width));
+    }
+    return ranges;
+}
+
+template< typename T, typename K, typename S>
+static void BM_Insert(benchmark::State& state)
+{
+    const size_t n = static_cast<size_t>(state.range(0));
+    const int dist = static_cast<int>(state.range(1));
+    size_t peak = 0;
+    for(auto _ : state)
+    {
+        const size_t base = malloc_count_current();
+        malloc_count_reset_peak();
+        {
+            T rmq;
+            fill<T,K,S>(rmq, n, dist);
+            peak = malloc_count_peak() - base;
+            state.PauseTiming();
+        }
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n));
+    state.counters["peak_bytes"] = static_cast<double>(peak);
+    state.counters["bytes_per_elem"] = static_cast<double>(peak) / static_cast<double>(n);
+}
+
+template< typename K, typename S>
+static void BM_Build(benchmark::State& state)
+{
+    const size_t n = static_cast<size_t>(state.range(0));
+    std::mt19937_64 gen(42);
+    std::vector<S> values(n);
+    for(size_t i = 0; i < n; ++i)
+        values[i] = static_cast<S>(gen());
+    for(auto _ : state)
+    {
+        avl_rmq<K,S> rmq(values);
+        benchmark::DoNotOptimize(rmq(0, 1));
+        state.PauseTiming();
+        {
+            avl_rmq<K,S> tmp(std::move(rmq));
+        }
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n));
+}
+
+template< typename K, typename S>
+static void BM_BuildParallel(benchmark::State& state)
+{
+    const size_t n = static_cast<size_t>(state.range(0));
+    const size_t n_threads = static_cast<size_t>(state.range(1));
+    std::mt19937_64 gen(42);
+    std::vector<S> values(n);
+    for(size_t i = 0; i < n; ++i)
+        values[i] = static_cast<S>(gen());
+    avl_rmq<K,S> rmq;
+    for(auto _ : state)
+    {
+        rmq.build(values.begin(), values.end(), n_threads);
+        benchmark::DoNotOptimize(rmq(0, 1));
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n));
+}
+
+template< typename K, typename S>
+static void BM_ToVector(benchmark::State& state)
+{
+    const size_t n = static_cast<size_t>(state.range(0));
+    const size_t n_threads = static_cast<size_t>(state.range(1));
+    avl_rmq<K,S> rmq;
+    fill<avl_rmq<K,S>,K,S>(rmq, n, RANDOM);
+    for(auto _ : state)
+    {
+        std::vector<S> vec = n_threads > 0 ? rmq.to_vector(n_threads) : rmq.to_vector();
+        benchmark::DoNotOptimize(vec.data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n));
+}
+
+template< typename T, typename K, typename S>
+static void BM_Update(benchmark::State& state)
+{
+    const size_t n = static_cast<size_t>(state.range(0));
+    T rmq;
+    fill<T,K,S>(rmq, n, RANDOM);
+    std::mt19937_64 gen(44);
+    for(auto _ : state)
+        rmq.update(static_cast<K>(gen() % n), static_cast<S>(gen()));
+    state.SetItemsProcessed(state.iterations());
+}
+
+template< typename T, typename K, typename S>
+static void BM_Access(benchmark::State& state)
+{
+    const size_t n = static_cast<size_t>(state.range(0));
+    T rmq;
+    fill<T,K,S>(rmq, n, RANDOM);
+    std::mt19937_64 gen(45);
+    for(auto _ : state)
+        benchmark::DoNotOptimize(static_cast<S>(rmq[static_cast<K>(gen() % n)]));
+    state.SetItemsProcessed(state.iterations());
+}
+
+template< typename T, typename K, typename S>
+static void BM_Query(benchmark::State& state)
+{
+    const size_t n = static_cast<size_t>(state.range(0));
+    const size_t width = static_cast<size_t>(state.range(1));
+    T rmq;
+    fill<T,K,S>(rmq, n, RANDOM);
+    const std::vector< std::pair<K,K> > ranges = random_ranges<K>(n, width);
+    size_t i = 0;
+    for(auto _ : state)
+    {
+        benchmark::DoNotOptimize(rmq(ranges[i].first, ranges[i].second));
+        i = (i + 1) % n_queries;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// The last argument of BM_AccessPrefetch and BM_QueryPrefetch is 0 for the
+// plain descents and 1 for the prefetching ones.
+template< typename K, typename S>
+static void BM_AccessPrefetch(benchmark::State& state)
+{
+    const size_t n = static_cast<size_t>(state.range(0));
+    avl_rmq<K,S> rmq;
+    fill<avl_rmq<K,S>,K,S>(rmq, n, RANDOM);
+    rmq.set_prefetch(state.range(1) != 0);
+    std::mt19937_64 gen(45);
+    for(auto _ : state)
+        benchmark::DoNotOptimize(static_cast<S>(rmq[static_cast<K>(gen() % n)]));
+    state.SetItemsProcessed(state.iterations());
+}
+
+template< typename K, typename S>
+static void BM_QueryPrefetch(benchmark::State& state)
+{
+    const size_t n = static_cast<size_t>(state.range(0));
+    const size_t width = static_cast<size_t>(state.range(1));
+    avl_rmq<K,S> rmq;
+    fill<avl_rmq<K,S>,K,S>(rmq, n, RANDOM);
+    rmq.set_prefetch(state.range(2) != 0);
+    const std::vector< std::pair<K,K> > ranges = random_ranges<K>(n, width);
+    size_t i = 0;
+    for(auto _ : state)
+    {
+        benchmark::DoNotOptimize(rmq(ranges[i].first, ranges[i].second));
+        i = (i + 1) % n_queries;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// The last argument of BM_AccessCompact and BM_QueryCompact is 1 if the tree
+// is compacted after the insertions.
+template< typename K, typename S>
+static void BM_AccessCompact(benchmark::State& state)
+{
+    const size_t n = static_cast<size_t>(state.range(0));
+    avl_rmq<K,S> rmq;
+    fill<avl_rmq<K,S>,K,S>(rmq, n, RANDOM);
+    if(state.range(1) != 0)
+        rmq.compact();
+    std::mt19937_64 gen(45);
+    for(auto _ : state)
+        benchmark::DoNotOptimize(static_cast<S>(rmq[static_cast<K>(gen() % n)]));
+    state.SetItemsProcessed(state.iterations());
+}
+
+template< typename K, typename S>
+static void BM_QueryCompact(benchmark::State& state)
+{
+    const size_t n = static_cast<size_t>(state.range(0));
+    const size_t width = static_cast<size_t>(state.range(1));
+    avl_rmq<K,S> rmq;
+    fill<avl_rmq<K,S>,K,S>(rmq, n, RANDOM);
+    if(state.range(2) != 0)
+        rmq.compact();
+    const std::vector< std::pair<K,K> > ranges = random_ranges<K>(n, width);
+    size_t i = 0;
+    for(auto _ : state)
+    {
+        benchmark::DoNotOptimize(rmq(ranges[i].first, ranges[i].second));
+        i = (i + 1) % n_queries;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// BM_WindowAvl and BM_WindowSliding slide a window of n values: each step
+// appends a value, removes the first one and queries the whole window.
+template< typename K, typename S>
+static void BM_WindowAvl(benchmark::State& state)
+{
+    const size_t n = static_cast<size_t>(state.range(0));
+    avl_rmq<K,S> rmq;
+    fill<avl_rmq<K,S>,K,S>(rmq, n, SEQUENTIAL);
+    std::mt19937_64 gen(46);
+    for(auto _ : state)
+    {
+        rmq.insert(static_cast<K>(n), static_cast<S>(gen()));
+        rmq.erase(0);
+        benchmark::DoNotOptimize(rmq(0, static_cast<K>(n)));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+template< typename K, typename S>
+static void BM_WindowSliding(benchmark::State& state)
+{
+    const size_t n = static_cast<size_t>(state.range(0));
+    sliding_window_rmq<K,S> rmq;
+    std::mt19937_64 gen(42);
+    for(size_t i = 0; i < n; ++i)
+        rmq.push_back(static_cast<S>(gen()));
+    gen.seed(46);
+    for(auto _ : state)
+    {
+        rmq.push_back(static_cast<S>(gen()));
+        rmq.pop_front();
+        benchmark::DoNotOptimize(rmq(0, static_cast<K>(n)));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// BM_AsyncEnqueue measures the latency of the writer of an async_rmq, while
+// BM_AsyncFill also waits for the n insertions to be applied, as BM_Insert.
+template< typename K, typename S>
+static void BM_AsyncEnqueue(benchmark::State& state)
+{
+    const int dist = static_cast<int>(state.range(0));
+    async_rmq<K,S> rmq;
+    std::mt19937_64 gen(42);
+    size_t i = 0;
+    for(auto _ : state)
+    {
+        rmq.insert(next_rank<K>(gen, i, dist), static_cast<S>(gen()));
+        ++i;
+    }
+    // Out of the timed loop, the backlog is drained before the destructor.
+    rmq.flush();
+    state.SetItemsProcessed(state.iterations());
+}
+
+template< typename K, typename S>
+static void BM_AsyncFill(benchmark::State& state)
+{
+    const size_t n = static_cast<size_t>(state.range(0));
+    const int dist = static_cast<int>(state.range(1));
+    for(auto _ : state)
+    {
+        {
+            async_rmq<K,S> rmq;
+            std::mt19937_64 gen(42);
+            uint64_t seq = 0;
+            for(size_t i = 0; i < n; ++i)
+                seq = rmq.insert(next_rank<K>(gen, i, dist), static_cast<S>(gen()));
+            rmq.wait(seq);
+            state.PauseTiming();
+        }
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n));
+}
+
+template< typename K, typename S>
+static void BM_QueryFrozen(benchmark::State& state)
+{
+    const size_t n = static_cast<size_t>(state.range(0));
+    const size_t width = static_cast<size_t>(state.range(1));
+    avl_rmq<K,S> rmq;
+    fill<avl_rmq<K,S>,K,S>(rmq, n, RANDOM);
+    rmq.freeze();
+    const std::vector< std::pair<K,K> > ranges = random_ranges<K>(n, width);
+    size_t i = 0;
+    for(auto _ : state)
+    {
+        benchmark::DoNotOptimize(rmq(ranges[i].first, ranges[i].second));
+        i = (i + 1) % n_queries;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+template< typename K, typename S>
+static void BM_QueryBatch(benchmark::State& state)
+{
+    const size_t n = static_cast<size_t>(state.range(0));
+    const size_t width = static_cast<size_t>(state.range(1));
+    avl_rmq<K,S> rmq;
+    fill<avl_rmq<K,S>,K,S>(rmq, n, RANDOM);
+    const std::vector< std::pair<K,K> > ranges = random_ranges<K>(n, width);
+    std::vector<S> out(n_queries);
+    for(auto _ : state)
+    {
+        rmq.query_batch(ranges.data(), n_queries, out.data());
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(n_queries));
+}
+
+static void sizes(benchmark::internal::Benchmark* b)
+{
+    for(int64_t n = 1 << 10; n <= (int64_t(1) << DYNAMIC_RMQ_BENCH_MAX_LOG); n <<= 4)
+        b->Arg(n);
+}
+
+static void sizes_dists(benchmark::internal::Benchmark* b)
+{
+    for(int64_t n = 1 << 10; n <= (int64_t(1) << DYNAMIC_RMQ_BENCH_MAX_LOG); n <<= 4)
+        for(int64_t dist = RANDOM; dist <= SKEWED; ++dist)
+            b->Args({n, dist});
+}
+
+static void sizes_widths(benchmark::internal::Benchmark* b)
+{
+    for(int64_t n = 1 << 10; n <= (int64_t(1) << DYNAMIC_RMQ_BENCH_MAX_LOG); n <<= 4)
+        for(int64_t width = 16; width <= n; width <<= 6)
+            b->Args({n, width});
+}
+
+static void sizes_toggle(benchmark::internal::Benchmark* b)
+{
+    for(int64_t n = 1 << 10; n <= (int64_t(1) << DYNAMIC_RMQ_BENCH_MAX_LOG); n <<= 4)
+        for(int64_t toggle = 0; toggle <= 1; ++toggle)
+            b->Args({n, toggle});
+}
+
+static void sizes_widths_toggle(benchmark::internal::Benchmark* b)
+{
+    for(int64_t n = 1 << 10; n <= (int64_t(1) << DYNAMIC_RMQ_BENCH_MAX_LOG); n <<= 4)
+        for(int64_t width = 16; width <= n; width <<= 6)
+            for(int64_t toggle = 0; toggle <= 1; ++toggle)
+                b->Args({n, width, toggle});
+}
+
+// The thread count 0 in BM_ToVector is the sequential to_vector.
+static void sizes_threads(benchmark::internal::Benchmark* b)
+{
+    const int64_t max_threads = std::max<int64_t>(1, std::thread::hardware_concurrency());
+    for(int64_t n = 1 << 10; n <= (int64_t(1) << DYNAMIC_RMQ_BENCH_MAX_LOG); n <<= 4)
+    {
+        b->Args({n, 0});
+        for(int64_t t = 1; t <= max_threads; t <<= 1)
+            b->Args({n, t});
+    }
+}
+
+#define RMQ_BENCHMARKS(T, K, S)                                              \
+    BENCHMARK_TEMPLATE(BM_Insert, T, K, S)->Apply(sizes_dists)               \
+        ->Unit(benchmark::kMillisecond);                                     \
+    BENCHMARK_TEMPLATE(BM_Update, T, K, S)->Apply(sizes);                    \
+    BENCHMARK_TEMPLATE(BM_Access, T, K, S)->Apply(sizes);                    \
+    BENCHMARK_TEMPLATE(BM_Query, T, K, S)->Apply(sizes_widths);
+
+typedef avl_rmq<uint32_t,uint32_t> avl_32_32;
+typedef avl_rmq<uint64_t,uint64_t> avl_64_64;
+typedef compact_avl_rmq<uint32_t,uint32_t> compact_32_32;
+typedef btree_rmq<uint32_t,uint32_t> btree_32_32;
+typedef btree_rmq<uint64_t,uint64_t> btree_64_64;
+typedef bucket_avl_rmq<uint32_t,uint32_t> bucket_32_32;
+
+RMQ_BENCHMARKS(avl_32_32, uint32_t, uint32_t)
+RMQ_BENCHMARKS(avl_64_64, uint64_t, uint64_t)
+RMQ_BENCHMARKS(compact_32_32, uint32_t, uint32_t)
+RMQ_BENCHMARKS(btree_32_32, uint32_t, uint32_t)
+RMQ_BENCHMARKS(btree_64_64, uint64_t, uint64_t)
+RMQ_BENCHMARKS(bucket_32_32, uint32_t, uint32_t)
+
+BENCHMARK_TEMPLATE(BM_Build, uint32_t, uint32_t)->Apply(sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_QueryBatch, uint32_t, uint32_t)->Apply(sizes_widths);
+BENCHMARK_TEMPLATE(BM_QueryFrozen, uint32_t, uint32_t)->Apply(sizes_widths);
+BENCHMARK_TEMPLATE(BM_AccessPrefetch, uint32_t, uint32_t)->Apply(sizes_toggle);
+BENCHMARK_TEMPLATE(BM_QueryPrefetch, uint32_t, uint32_t)->Apply(sizes_widths_toggle);
+BENCHMARK_TEMPLATE(BM_AsyncEnqueue, uint32_t, uint32_t)->DenseRange(RANDOM, SKEWED)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_AsyncFill, uint32_t, uint32_t)->Apply(sizes_dists)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_WindowAvl, uint32_t, uint32_t)->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_WindowSliding, uint32_t, uint32_t)->Apply(sizes);
+BENCHMARK_TEMPLATE(BM_AccessCompact, uint32_t, uint32_t)->Apply(sizes_toggle);
+BENCHMARK_TEMPLATE(BM_QueryCompact, uint32_t, uint32_t)->Apply(sizes_widths_toggle);
+BENCHMARK_TEMPLATE(BM_BuildParallel, uint32_t, uint32_t)->Apply(sizes_threads)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ToVector, uint32_t, uint32_t)->Apply(sizes_threads)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,461 @@
+////////////////////////////////////////////////////////////////////////////////
+// async_rmq.hpp
+//   Write-behind front end of avl_rmq.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Massimiliano Rossi
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+/*!
+   \file async_rmq.hpp
+   \brief async_rmq.hpp Write-behind front end of avl_rmq.
+   \author Massimiliano Rossi
+   \date 20/10/2021
+*/
+
+#ifndef _ASYNC_RMQ_HH
+#define _ASYNC_RMQ_HH
+
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <utility>
+#include <assert.h>
+#include "avl_rmq.hpp"
+
+/*!
+* Front end of avl_rmq that decouples the writers from the cost of the
+* insertions. insert and update push the edit in a lock-free multi producer
+* single consumer queue and return its sequence number, without touching the
+* tree. A background thread drains the queue and applies the edits in order,
+* turning the runs of insertions with increasing ranks into insert_batch and
+* the runs of updates with non-decreasing ranks into update_batch, so that the
+* rotations are amortized across the batch.
+* The ranks of an edit refer to the array after all the edits that precede it
+* in the queue. The order of the edits of concurrent writers is the order in 
+* which they enter the queue, while the edits of a single writer are applied
+* in the order in which they have been issued.
+* The queries see the edits applied so far. wait(seq) blocks until the edit
+* with sequence number seq, and all the ones with smaller sequence numbers,
+* have been applied, hence a query issued after wait(seq) sees them.
+* K is the type of the keys
+* S is the type of the values
+* Op is the aggregate maintained for each subtree, see rmq_ops.hpp
+*/
+template< typename K, typename S, typename Op = rmq_min<S> >
+class async_rmq{
+public:
+
+    typedef avl_rmq<K,S,Op> tree_t;
+    typedef typename Op::value_type agg_t;
+
+    /*!
+    * Costructor, starts the background thread.
+    * @param max_batch_ the largest number of edits applied at once.
+    */
+    async_rmq(size_t max_batch_ = 1 << 12):
+        async_rmq(std::vector<S>(), max_batch_)
+    {
+
+    }
+
+    /*!
+    * Costructor, builds the tree from the array and starts the background 
+    * thread.
+    * @param vec        the array.
+    * @param max_batch_ the largest number of edits applied at once.
+    */
+    async_rmq(const std::vector<S>& vec, size_t max_batch_ = 1 << 12):
+        tree(vec),
+        tree_mutex(),
+        stub(),
+        head(&stub),
+        tail(&stub),
+        issued(0),
+        processed(0),
+        applied(0),
+        early(),
+        sleeping(false),
+        stop(false),
+        wake_mutex(),
+        wake_cv(),
+        done_mutex(),
+        done_cv(),
+        max_batch(std::max<size_t>(max_batch_, 1)),
+        applier(&async_rmq::run, this)
+    {
+
+    }
+
+    async_rmq(const async_rmq&) = delete;
+    async_rmq& operator=(const async_rmq&) = delete;
+
+    /*!
+    * Desctructor
+    * Applies the pending edits and stops the background thread.
+    */
+    ~async_rmq()
+    {
+        stop.store(true, std::memory_order_seq_cst);
+        wake();
+        applier.join();
+    }
+
+    /*!
+     * Enqueue the insertion of the value with rank rank. Never waits for the
+     * tree.
+     * @param rank  the rank of the element that has to be inserted.
+     * @param value the value information attached to the element.
+     * @return      the sequence number of the edit.
+     */
+    uint64_t insert(K rank, const S& value)
+    {
+        return enqueue(true, rank, value);
+    }
+
+    /*!
+     * Enqueue the update of the value with rank rank. Never waits for the
+     * tree.
+     * @param rank  the rank of the element that has to be updated.
+     * @param value the new value.
+     * @return      the sequence number of the edit.
+     */
+    uint64_t update(K rank, const S& value)
+    {
+        return enqueue(false, rank, value);
+    }
+
+    /*!
+     * Block until the edit with sequence number seq, and all the ones with
+     * smaller sequence numbers, have been applied.
+     * @param seq   the sequence number, returned by insert or update. A
+     *              sequence number not yet issued would block forever.
+     */
+    void wait(uint64_t seq)
+    {
+        assert(seq <= issued.load(std::memory_order_seq_cst));
+        std::unique_lock<std::mutex> lock(done_mutex);
+        done_cv.wait(lock, [this, seq]() { return applied >= seq; });
+    }
+
+    /*!
+     * Block until all the edits issued before the call have been applied.
+     */
+    void flush()
+    {
+        wait(issued.load(std::memory_order_seq_cst));
+    }
+
+    /*!
+     * @return the largest sequence number such that all the edits up to it
+     *         have been applied.
+     */
+    uint64_t last_applied()
+    {
+        std::lock_guard<std::mutex> lock(done_mutex);
+        return applied;
+    }
+
+    /*!
+     * @return the number of elements of the array, after the applied edits.
+     */
+    K size()
+    {
+        std::lock_guard<std::mutex> lock(tree_mutex);
+        return tree.size();
+    }
+
+    /*!
+     * Access the array, after the applied edits.
+     * @param rank  the rank of the element to be accessed.
+     */
+    S operator[](K rank)
+    {
+        std::lock_guard<std::mutex> lock(tree_mutex);
+        return tree.access(rank);
+    }
+
+    /*!
+     * Computes the aggregate of the interval [left, right) of the array, 
+     * after the applied edits.
+     * @param left  the left boundary interval (includisve).
+     * @param right the right boundary of the interval (exclusive).
+     */
+    agg_t operator ()(K left, K right)
+    {
+        std::lock_guard<std::mutex> lock(tree_mutex);
+        return tree(left, right);
+    }
+
+    /*!
+     * Computes the aggregate of the interval [left, right) of the array, 
+     * after the edit with sequence number seq has been applied.
+     * @param seq   the sequence number.
+     * @param left  the left boundary interval (includisve).
+     * @param right the right boundary of the interval (exclusive).
+     */
+    agg_t query(uint64_t seq, K left, K right)
+    {
+        wait(seq);
+        return (*this)(left, right);
+    }
+
+    /*!
+     * Converts the array into an std::vector, after the applied edits.
+     */
+    std::vector<S> to_vector()
+    {
+        std::lock_guard<std::mutex> lock(tree_mutex);
+        return tree.to_vector();
+    }
+
+  protected:
+
+    /*!
+     * An edit in the queue.
+     */
+    typedef struct edit_t{
+        std::atomic<edit_t*> next; // The next edit in the queue.
+        uint64_t seq;              // The sequence number.
+        K rank;                    // The rank of the element.
+        S value;                   // The value.
+        bool is_insert;            // Whether the edit is an insertion or an update.
+
+        edit_t():
+            next(nullptr),
+            seq(0),
+            rank(0),
+            value(),
+            is_insert(false)
+        {
+
+        }
+    }edit_t;
+
+    /*!
+     * Push an edit in the queue, and wake up the background thread if it is
+     * waiting for edits.
+     */
+    uint64_t enqueue(bool is_insert, K rank, const S& value)
+    {
+        edit_t* edit = new edit_t();
+        edit->rank = rank;
+        edit->value = value;
+        edit->is_insert = is_insert;
+        // The edit may be applied and released as soon as it is pushed.
+        const uint64_t seq = issued.fetch_add(1, std::memory_order_seq_cst) + 1;
+        edit->seq = seq;
+        push(edit);
+        if(sleeping.load(std::memory_order_seq_cst))
+            wake();
+        return seq;
+    }
+
+    /*!
+     * Wake up the background thread.
+     */
+    void wake()
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        wake_cv.notify_one();
+    }
+
+    /*!
+     * Append the edit to the queue, following the intrusive MPSC queue of
+     * D. Vyukov: the producers exchange the head, then link the previous one.
+     */
+    void push(edit_t* edit)
+    {
+        edit->next.store(nullptr, std::memory_order_relaxed);
+        edit_t* prev = head.exchange(edit, std::memory_order_acq_rel);
+        prev->next.store(edit, std::memory_order_release);
+    }
+
+    /*!
+     * Remove the first edit of the queue. Called only by the background thread.
+     * @return the edit, or nullptr if the queue is empty or if the first edit 
+     *         is not linked yet.
+     */
+    edit_t* pop()
+    {
+        edit_t* first = tail;
+        edit_t* next = first->next.load(std::memory_order_acquire);
+        if(first == &stub)
+        {
+            if(next == nullptr)
+                return nullptr;
+            tail = next;
+            first = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if(next != nullptr)
+        {
+            tail = next;
+            return first;
+        }
+        if(first != head.load(std::memory_order_acquire))
+            return nullptr;
+        // The queue has a single edit: put back the stub to detach it.
+        push(&stub);
+        next = first->next.load(std::memory_order_acquire);
+        if(next != nullptr)
+        {
+            tail = next;
+            return first;
+        }
+        return nullptr;
+    }
+
+    /*!
+     * Body of the background thread.
+     */
+    void run()
+    {
+        std::vector<edit_t*> batch;
+        batch.reserve(max_batch);
+        while(true)
+        {
+            edit_t* edit;
+            while(batch.size() < max_batch and (edit = pop()) != nullptr)
+                batch.push_back(edit);
+
+            if(not batch.empty())
+            {
+                apply(batch);
+                for(size_t i = 0; i < batch.size(); ++i)
+                    delete batch[i];
+                batch.clear();
+                continue;
+            }
+
+            if(processed != issued.load(std::memory_order_seq_cst))
+            {
+                // An edit is being linked.
+                std::this_thread::yield();
+                continue;
+            }
+            if(stop.load(std::memory_order_seq_cst))
+                break;
+
+            std::unique_lock<std::mutex> lock(wake_mutex);
+            sleeping.store(true, std::memory_order_seq_cst);
+            wake_cv.wait(lock, [this]() { 
+                return processed != issued.load(std::memory_order_seq_cst) or stop.load(std::memory_order_seq_cst); 
+            });
+            sleeping.store(false, std::memory_order_seq_cst);
+        }
+    }
+
+    /*!
+     * Apply the edits in order, and advance the applied sequence numbers.
+     */
+    void apply(const std::vector<edit_t*>& batch)
+    {
+        {
+            std::lock_guard<std::mutex> lock(tree_mutex);
+            std::vector< std::pair<K,S> > run;
+            for(size_t i = 0; i < batch.size(); )
+            {
+                size_t j = i;
+                run.clear();
+                if(batch[i]->is_insert)
+                {
+                    // The ranks of a run with increasing ranks are shifted to 
+                    // the array before the run, as required by insert_batch.
+                    const K n = tree.size();
+                    for(; j < batch.size() and batch[j]->is_insert; ++j)
+                    {
+                        const K shift = static_cast<K>(j - i);
+                        const K rank = std::min<K>(batch[j]->rank, n + shift);
+                        if(j > i and rank < run.back().first + shift)
+                            break;
+                        run.push_back(std::make_pair(rank - shift, batch[j]->value));
+                    }
+                    tree.insert_batch(run.data(), run.size());
+                }
+                else
+                {
+                    const K n = tree.size();
+                    for(; j < batch.size() and not batch[j]->is_insert; ++j)
+                    {
+                        if(j > i and batch[j]->rank < batch[j - 1]->rank)
+                            break;
+                        if(batch[j]->rank < n)
+                            run.push_back(std::make_pair(batch[j]->rank, batch[j]->value));
+                    }
+                    tree.update_batch(run.data(), run.size());
+                }
+                i = j;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(done_mutex);
+        for(size_t i = 0; i < batch.size(); ++i)
+        {
+            // The edits enter the queue out of order only while their 
+            // producers race, hence the window stays short.
+            const size_t k = static_cast<size_t>(batch[i]->seq - applied - 1);
+            if(k >= early.size())
+                early.resize(k + 1, false);
+            early[k] = true;
+        }
+        while(not early.empty() and early.front())
+        {
+            applied++;
+            early.pop_front();
+        }
+        processed += batch.size();
+        done_cv.notify_all();
+    }
+
+  private:
+    tree_t tree;                // The array after the applied edits.
+    std::mutex tree_mutex;      // Serializes the accesses to the tree.
+
+    edit_t stub;                // The placeholder keeping the queue non empty.
+    std::atomic<edit_t*> head;  // The last edit of the queue.
+    edit_t* tail;               // The first edit of the queue, owned by the background thread.
+
+    std::atomic<uint64_t> issued;   // The last sequence number issued.
+    uint64_t processed;             // The number of edits applied.
+    uint64_t applied;               // All the edits up to this sequence number have been applied.
+    std::deque<bool> early;         // Whether each edit after applied has been applied, by sequence number.
+
+    std::atomic<bool> sleeping;     // Whether the background thread waits for edits.
+    std::atomic<bool> stop;         // Whether the background thread has to stop.
+    std::mutex wake_mutex;
+    std::condition_variable wake_cv;
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+
+    const size_t max_batch;         // The largest number of edits applied at once.
+    std::thread applier;            // The background thread.
+
+}; // async_rmq
+
+#endif /* end of include guard: _ASYNC_RMQ_HH */
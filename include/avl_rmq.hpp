@@ -36,12 +36,24 @@
 #ifndef _AVL_RMQ_HH
 #define _AVL_RMQ_HH
 
+#include <iostream>
 #include <vector>
+#include <algorithm>
 #include <assert.h>
 #include <typeinfo>
 #include <type_traits>
 #include <limits>
-
+#include <iterator>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <new>
+#include <thread>
+#include "node_pool.hpp"
+#include "rmq_ops.hpp"
+#include "rmq_image.hpp"
+#include "static_rmq.hpp"
+#include "rmq_stats.hpp"
 
 
 template< typename T>
@@ -50,15 +62,58 @@ constexpr bool in_range_unsigned(const long long int x)
     return  ((x-std::numeric_limits<T>::min()) <= (std::numeric_limits<T>::max()-std::numeric_limits<T>::min()));
 }
 
+/*!
+* Fields of the nodes needed by the range updates. Empty unless the aggregate
+* is wrapped in rmq_lazy, so that the nodes of the other trees do not grow.
+*/
+template< typename K, typename S, bool lazy>
+struct avl_lazy_fields{
+};
+
+template< typename K, typename S>
+struct avl_lazy_fields<K,S,true>{
+    K size;           // The number of elements of the subtree.
+    S add;            // The increment pending for the children, applied after set.
+    S set;            // The assignment pending for the children, if has_set.
+    bool has_set;     // Whether there is a pending assignment.
+
+    avl_lazy_fields():
+        size(1),
+        add(0),
+        set(),
+        has_set(false)
+    {
+
+    }
+};
+
 /*!
 * K is the type of the keys
 * S is the type of the values
+* Op is the aggregate maintained for each subtree, see rmq_ops.hpp. The values
+*    are stored in Op::storage_type, if provided, e.g. avl_rmq<uint32_t,
+*    uint64_t, rmq_min<uint64_t,uint16_t>> stores the values and the minimums
+*    in 16 bits, shrinking the node from 48 to 32 bytes.
+* Stats is the policy recording the statistics of the operations, see 
+*    rmq_stats.hpp. The default rmq_no_stats records nothing.
 * inspired from https://www.softwaretestinghelp.com/avl-trees-and-heap-data-structure-in-cpp/
 */
-template< typename K, typename S>
+template< typename K, typename S, typename Op = rmq_min<S>, typename Stats = rmq_no_stats >
 class avl_rmq{
 public:
 
+    typedef typename Op::value_type agg_t;
+    typedef std::integral_constant<bool, std::is_base_of<rmq_lazy_tag, Op>::value> lazy_t;
+    typedef typename rmq_storage<Op, S>::type value_t;
+    typedef typename rmq_agg_storage<Op>::type agg_store_t;
+    typedef rmq_narrow<S, value_t> narrow_t;
+    typedef rmq_narrow<agg_t, agg_store_t> narrow_agg_t;
+    // The stored values are returned by reference only if they have type S.
+    typedef typename std::conditional<std::is_same<S, value_t>::value, const S&, S>::type const_reference;
+
+    // The nodes store their depth rather than a 2-bit balance factor, since
+    // join, split and the batch operations compare the depths of subtrees 
+    // that are not siblings. The depth is at most 1.44 log n.
     typedef typename std::conditional<in_range_unsigned<uint8_t>(8*sizeof(K)),uint8_t,
                 typename std::conditional<in_range_unsigned<uint16_t>(8*sizeof(K)), uint16_t ,
                     typename std::conditional<in_range_unsigned<uint32_t>(8*sizeof(K)), uint32_t ,
@@ -68,10 +123,12 @@ public:
         >::type d_t;
 
 
-    typedef struct node_t{
-        K rank;           // The ranks of the node with respect to its subtree.
-        S value;          // The value of the node.
-        S min;            // The minimum value of the subtree.
+    struct emplace_tag{};
+
+    typedef struct node_t : public avl_lazy_fields<K, S, lazy_t::value>{
+        K rank;           // The ranks of the node with respect to its subtree, i.e., the size of its left subtree.
+        value_t value;    // The value of the node.
+        agg_store_t agg;  // The aggregate of the values of the subtree.
         d_t depth;        // The depth of the node.
         node_t *left;     // The pointer to the left child of the node.
         node_t *right;    // The pointer to the right child of the node.
@@ -79,24 +136,46 @@ public:
         /*!
         * Costructor
         */
-        node_t(K rank, S value, S min, d_t depth = 1, node_t* left = nullptr, node_t* right = nullptr):
-            rank(rank),
-            value(value),
-            min(min),
-            depth(depth),
-            left(left),
-            right(right)
+        node_t(K rank_, S value_, agg_t agg_, d_t depth_ = 1, node_t* left_ = nullptr, node_t* right_ = nullptr):
+            rank(rank_),
+            value(narrow_t::store(std::move(value_))),
+            agg(narrow_agg_t::store(agg_)),
+            depth(depth_),
+            left(left_),
+            right(right_)
+        {
+
+        }
+
+        /*!
+        * Costructor of a leaf, whose value is constructed in place from args.
+        */
+        template< typename... Args>
+        node_t(emplace_tag, Args&&... args):
+            rank(0),
+            value(make_value(std::is_same<S, value_t>(), std::forward<Args>(args)...)),
+            agg(narrow_agg_t::store(Op::lift(value))),
+            depth(1),
+            left(nullptr),
+            right(nullptr)
         {
 
         }
 
         /*!
-        * Desctructor
+        * Construct the value in place, or narrow it if it is stored in a
+        * narrower type than S.
         */
-        ~node_t()
+        template< typename... Args>
+        static inline value_t make_value(std::true_type, Args&&... args)
+        {
+            return value_t(std::forward<Args>(args)...);
+        }
+
+        template< typename... Args>
+        static inline value_t make_value(std::false_type, Args&&... args)
         {
-            if(left != nullptr) delete left;
-            if(right != nullptr) delete right;
+            return narrow_t::store(S(std::forward<Args>(args)...));
         }
 
         /*!
@@ -109,277 +188,1588 @@ public:
         }
 
         /*!
-        * Return the depth of the node
-        * @return true if the node is a leaf, false otherwise
+        * Recompute the aggregate of the subtree from the ones of the children.
+        * @return the aggregate of the subtree.
         */
-        inline S update_min()
+        inline agg_t update_agg()
         {
-            min = value;
+            agg_t res = Op::lift(value);
             if(left != nullptr)
-                min = std::min(min, left->min);
+                res = Op::combine(left->agg, res);
             if(right != nullptr)
-                min = std::min(min, right->min);
-            return min;
+                res = Op::combine(res, right->agg);
+            agg = narrow_agg_t::store(res);
+            update_size(lazy_t());
+            return res;
+        }
+
+        /*!
+        * Copy the aggregate of a node spanning the same elements.
+        */
+        inline void copy_agg(const node_t& other)
+        {
+            agg = other.agg;
+            copy_size(other, lazy_t());
+        }
+
+        inline void update_size(std::false_type) { }
+        inline void update_size(std::true_type)
+        {
+            this->size = 1 + (left != nullptr ? left->size : 0) + (right != nullptr ? right->size : 0);
+        }
+
+        inline void copy_size(const node_t&, std::false_type) { }
+        inline void copy_size(const node_t& other, std::true_type)
+        {
+            this->size = other.size;
         }
   
     }node_t;
 
+    /*!
+    * Reference to an element of the array, returned by []. Reading it is an
+    * access, and assigning it is an update, that fixes the aggregates.
+    */
+    class value_ref{
+    public:
+        inline operator S() const
+        {
+            return tree->access(rank);
+        }
+
+        inline value_ref& operator=(const S& value)
+        {
+            tree->update(rank, value);
+            return *this;
+        }
+
+        inline value_ref& operator=(S&& value)
+        {
+            tree->update(rank, std::move(value));
+            return *this;
+        }
+
+        inline value_ref& operator=(const value_ref& other)
+        {
+            return *this = static_cast<S>(other);
+        }
+
+    private:
+        friend class avl_rmq;
+
+        value_ref(avl_rmq* tree_, K rank_):
+            tree(tree_),
+            rank(rank_)
+        {
+
+        }
+
+        avl_rmq* tree;  // The tree storing the element.
+        K rank;         // The rank of the element.
+    };
+
+    /*!
+    * Bidirectional iterator over the values of the array, in order. It stores
+    * the path from the root to the current node, hence each step takes O(1)
+    * amortized time. The iterators are invalidated by the modifications of 
+    * the tree, and by compact, but not by the queries.
+    */
+    class iterator{
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef S value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const S* pointer;
+        typedef typename avl_rmq::const_reference reference;
+
+        /*!
+        * Costructor of a singular iterator.
+        */
+        iterator():
+            tree(nullptr),
+            path(),
+            pos(0)
+        {
+
+        }
+
+        iterator(const iterator&) = default;
+        iterator(iterator&&) = default;
+        iterator& operator=(const iterator&) = default;
+        iterator& operator=(iterator&&) = default;
+
+        inline reference operator*() const
+        {
+            return path.back()->value;
+        }
+
+        /*!
+        * Available only if the values are stored with type S.
+        */
+        inline pointer operator->() const
+        {
+            return &path.back()->value;
+        }
+
+        /*!
+         * @return the rank of the current element.
+         */
+        inline K rank() const
+        {
+            return pos;
+        }
+
+        iterator& operator++()
+        {
+            node_t* node = path.back();
+            if(node->right != nullptr)
+                leftmost(node->right);
+            else
+            {
+                // Climb until node is in a left subtree.
+                path.pop_back();
+                while(not path.empty() and path.back()->right == node)
+                {
+                    node = path.back();
+                    path.pop_back();
+                }
+            }
+            ++pos;
+            return *this;
+        }
+
+        iterator& operator--()
+        {
+            if(path.empty())
+                rightmost(tree->root);
+            else
+            {
+                node_t* node = path.back();
+                if(node->left != nullptr)
+                    rightmost(node->left);
+                else
+                {
+                    // Climb until node is in a right subtree.
+                    path.pop_back();
+                    while(not path.empty() and path.back()->left == node)
+                    {
+                        node = path.back();
+                        path.pop_back();
+                    }
+                }
+            }
+            --pos;
+            return *this;
+        }
+
+        inline iterator operator++(int)
+        {
+            iterator res(*this);
+            ++(*this);
+            return res;
+        }
+
+        inline iterator operator--(int)
+        {
+            iterator res(*this);
+            --(*this);
+            return res;
+        }
+
+        inline bool operator==(const iterator& other) const
+        {
+            return pos == other.pos and tree == other.tree;
+        }
+
+        inline bool operator!=(const iterator& other) const
+        {
+            return not (*this == other);
+        }
+
+    private:
+        friend class avl_rmq;
+
+        iterator(avl_rmq* tree_, K pos_):
+            tree(tree_),
+            path(),
+            pos(pos_)
+        {
+
+        }
+
+        /*!
+         * Extends the path to the first node of the subtree.
+         */
+        void leftmost(node_t* node)
+        {
+            for(; node != nullptr; node = node->left)
+            {
+                tree->push(node);
+                path.push_back(node);
+            }
+        }
+
+        /*!
+         * Extends the path to the last node of the subtree.
+         */
+        void rightmost(node_t* node)
+        {
+            for(; node != nullptr; node = node->right)
+            {
+                tree->push(node);
+                path.push_back(node);
+            }
+        }
+
+        avl_rmq* tree;              // The tree.
+        std::vector<node_t*> path;  // The path from the root to the current node, empty at the end.
+        K pos;                      // The rank of the current node.
+    };
+
     /*!
     * Costructor
     */
     avl_rmq():
-        root(nullptr)
+        root(nullptr),
+        n_nodes(0),
+        pool(nullptr),
+        frozen(),
+        prefetch(false),
+        stats()
+    {
+
+    }
+
+    /*!
+    * Costructor
+    * Builds the tree from the array in linear time.
+    * @param vec  the array.
+    */
+    avl_rmq(const std::vector<S>& vec):
+        root(nullptr),
+        n_nodes(0),
+        pool(nullptr),
+        frozen(),
+        prefetch(false),
+        stats()
+    {
+        build(vec);
+    }
+
+    /*!
+    * Costructor
+    * Builds the tree from the range [first, last) in linear time.
+    * @param first  the iterator to the first element.
+    * @param last   the iterator past the last element.
+    */
+    template< typename It>
+    avl_rmq(It first, It last):
+        root(nullptr),
+        n_nodes(0),
+        pool(nullptr),
+        frozen(),
+        prefetch(false),
+        stats()
+    {
+        build(first, last);
+    }
+
+    avl_rmq(const avl_rmq&) = delete;
+    avl_rmq& operator=(const avl_rmq&) = delete;
+
+    /*!
+    * Move costructor
+    */
+    avl_rmq(avl_rmq&& other) noexcept:
+        root(other.root),
+        n_nodes(other.n_nodes),
+        pool(std::move(other.pool)),
+        frozen(std::move(other.frozen)),
+        prefetch(other.prefetch),
+        stats(other.stats)
     {
+        other.root = nullptr;
+        other.n_nodes = 0;
+    }
 
+    /*!
+    * Move assignment
+    */
+    avl_rmq& operator=(avl_rmq&& other) noexcept
+    {
+        if(this != &other)
+        {
+            release();
+            root = other.root;
+            n_nodes = other.n_nodes;
+            pool = std::move(other.pool);
+            frozen = std::move(other.frozen);
+            prefetch = other.prefetch;
+            stats = other.stats;
+            other.root = nullptr;
+            other.n_nodes = 0;
+        }
+        return *this;
     }
 
     /*!
     * Desctructor
+    * The nodes are released in bulk by the pool, the tree is visited only if
+    * the values need to be destroyed or if the pool is shared with other trees.
     */
     ~avl_rmq()
     {
-        if(root != nullptr) delete root;
+        release();
     }
 
     /*!
-     * Access the array. 
-     * @param rank  the rank of the element to be accessed.
+     * Replace the content of the tree with the array, in linear time.
+     * @param vec  the array.
      */
-    S operator[](K rank)
+    void build(const std::vector<S>& vec)
     {
-        if(root == nullptr or rank >= n_nodes )
-            return 0;
-        auto ret = search(root,rank);
-        return ret->value;
+        build(vec.begin(), vec.end());
     }
 
     /*!
-     * Insert the value in the tree with rank rank. The elemnt with the same rank 
-     * is moved on the right. 
-     * @param rank  the rank of the element that has to be inserted.
-     * @param value the value information attached to the element.
+     * Replace the content of the tree with the range [first, last), in linear
+     * time. The tree is perfectly balanced and its nodes are stored
+     * contiguously in in-order.
+     * @param first  the iterator to the first element.
+     * @param last   the iterator past the last element.
      */
-    void insert(K rank, S value)
+    template< typename It>
+    void build(It first, It last)
     {
-        root = insert(root,rank,value);
-        n_nodes ++;
+        release();
+        const size_t n = static_cast<size_t>(std::distance(first, last));
+        if(n == 0)
+            return;
+        node_t* block = get_pool().allocate_block(n);
+        root = build(block, n, first);
+        n_nodes = static_cast<K>(n);
     }
 
     /*!
-     * Update the value in the tree with rank rank. 
-     * @param rank  the rank of the element that has to be inserted.
-     * @param value the value information attached to the element.
+     * Replace the content of the tree with the range [first, last), as build,
+     * constructing disjoint subtrees from up to n_threads threads.
+     * @param first     the random access iterator to the first element.
+     * @param last      the random access iterator past the last element.
+     * @param n_threads the maximum number of threads used.
      */
-    void update(K rank, S value)
+    template< typename It>
+    void build(It first, It last, size_t n_threads)
     {
-        update(root,rank,value);
+        static_assert(std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<It>::iterator_category>::value,
+            "the parallel build requires random access iterators");
+        release();
+        const size_t n = static_cast<size_t>(last - first);
+        if(n == 0)
+            return;
+        node_t* block = get_pool().allocate_block(n);
+        root = build(block, n, first, n_threads);
+        n_nodes = static_cast<K>(n);
     }
 
     /*!
-     * Computes the minimum in the interval [left, right).
-     * @param left  the left boundary interval (includisve).
-     * @param right the right boundary of the interval (exclusive).
+     * @return the number of elements of the array.
      */
-    S operator ()(K left, K right)
+    inline K size() const
     {
-        if(left == 0 and right > n_nodes)
-            return get_min(root);
-        return min_range(root, left, right, (right > n_nodes));
+        return n_nodes;
     }
 
-
     /*!
-     * Access the i-th child of the node.
-     * @param i the index of the child to be returned
-     * @return  the i-th child of the node if it exists.
+     * Build a static index of the current array, answering [] and () in
+     * constant time until the next modification of the array, that releases
+     * it. See static_rmq.hpp.
      */
-    std::vector<S> to_vector()
+    void freeze()
     {
-        std::vector<S> res;
-        to_vector(root, res);
-        return res;
+        frozen.reset(new static_rmq<K,S,Op>(to_vector()));
     }
 
     /*!
-     * Print the tree.
+     * Rewrite the nodes of the tree contiguously in a fresh block of memory, in
+     * van Emde Boas order: the upper half of the levels of the tree is laid 
+     * out first, followed by the subtrees hanging from it, each laid out 
+     * recursively in the same way. A root to leaf path then touches 
+     * O(log_B n) blocks of B nodes, for any B, while after random insertions
+     * the nodes are scattered in allocation order. Runs in linear time, and 
+     * neither the array nor the static index built by freeze are modified.
      */
-    void print()
+    void compact()
     {
-        print(root);
-        std::cout << std::endl;
-    }
-
-    bool check_integrity(){
+        if(root == nullptr)
+            return;
+
+        std::vector<node_t*> order;
+        order.reserve(n_nodes);
+        veb_order(root, root->depth, order);
+
+        std::shared_ptr< node_pool<node_t> > fresh = std::make_shared< node_pool<node_t> >();
+        node_t* block = fresh->allocate_block(order.size());
+        for(size_t i = 0; i < order.size(); ++i)
+            new(block + i) node_t(*order[i]);
+        // The old nodes are no longer visited, and forward to their copies.
+        for(size_t i = 0; i < order.size(); ++i)
+            order[i]->left = block + i;
+        for(size_t i = 0; i < order.size(); ++i)
+        {
+            if(block[i].left != nullptr)
+                block[i].left = block[i].left->left;
+            if(block[i].right != nullptr)
+                block[i].right = block[i].right->left;
+        }
 
+        if(not pool.unique() or pool->is_forward())
+        {
+            for(size_t i = 0; i < order.size(); ++i)
+                pool->destroy(order[i]);
+        }
+        else
+        {
+            if(not std::is_trivially_destructible<node_t>::value)
+                for(size_t i = 0; i < order.size(); ++i)
+                    order[i]->~node_t();
+            pool->clear();
+        }
+        pool = std::move(fresh);
+        root = block;
     }
 
-  protected:
-
- 
     /*!
-     * Return the depth of the node
-     * @return true if the node is a leaf, false otherwise
+     * Release the static index built by freeze.
      */
-    inline const d_t get_depth(node_t* node)
+    inline void thaw()
     {
-        if(node == nullptr)
-            return 0;
-        return node->depth;
+        if(frozen != nullptr)
+            frozen.reset();
     }
 
     /*!
-     * Return the depth of the node
-     * @return true if the node is a leaf, false otherwise
+     * @return true if the queries are answered by the static index.
      */
-    inline const S get_min(node_t* node)
+    inline bool is_frozen() const
     {
-        if(node == nullptr)
-            return std::numeric_limits<S>::max();
-        return node->min;
+        return frozen != nullptr;
     }
-  
+
     /*!
-     * Return the depth of the node
-     * @return true if the node is a leaf, false otherwise
+     * Enable or disable the prefetching descents of [] and (). While 
+     * comparing the ranks of a node, a prefetching descent issues the loads
+     * of both its children, so that the latency of the next load overlaps
+     * with the work on the current node. This pays off on trees much larger
+     * than the last level cache.
+     * @param enable true to enable the prefetching.
      */
-    inline const int8_t get_balance(node_t* node)
+    inline void set_prefetch(bool enable)
     {
-        if(node == nullptr)
-            return 0;
-        return get_depth(node->left) - get_depth(node->right);
+        prefetch = enable;
     }
 
-  
     /*!
-     * Rotate the subtree to the right.
-     * @return the new root.
+     * @return true if the descents of [] and () prefetch the children.
      */
-    node_t* right_rotate(node_t* y)
+    inline bool is_prefetching() const
     {
-        node_t *x = y->left;  
-        node_t *tmp = x->right;  
-    
-        // Perform rotation  
-        x->right = y;  
-        y->left = tmp;  
-
-        // Update ranks
-        y->rank -= x->rank;
-
-        // Update mins
-        x->min = y->min;
-        y->update_min();
-    
-        // Update heights  
-        y->depth = std::max(get_depth(y->left), get_depth(y->right)) + 1;  
-        x->depth = std::max(get_depth(x->left), get_depth(x->right)) + 1;  
-    
-        // Return new root  
-        return x;   
+        return prefetch;
     }
 
     /*!
-     * Rotate the subtree to the left.
-     * @return the new root.
+     * @return the statistics of the operations, recorded by the policy Stats.
      */
-    node_t* left_rotate(node_t* x)
+    inline Stats& get_stats()
     {
-        node_t *y = x->right;  
-        node_t *tmp = y->left;  
-    
-        // Perform rotation  
-        y->left = x;  
-        x->right = tmp;  
-
-        // Update ranks
-        y->rank += x->rank;
-
-        // Update mins
-        y->min = x->min;
-        x->update_min();
-
-        // Update heights  
-        x->depth = std::max(get_depth(x->left), get_depth(x->right)) + 1;  
-        y->depth = std::max(get_depth(y->left), get_depth(y->right)) + 1;  
-    
-        // Return new root  
-        return y;   
+        return stats;
+    }
 
+    inline const Stats& get_stats() const
+    {
+        return stats;
     }
 
     /*!
-     * Finds the element of key rank in the subtree rooted in this node.
-     * @param  rank the rank of the element we look for.
-     * @return      the element in the tree.
+     * @return the memory used by the tree. If the pool is shared with other
+     *         trees, after a split, the slack is the one of the shared pool.
      */
-    node_t* search(node_t* node, K rank)
+    rmq_memory memory_usage() const
     {
-        // If node is null, create one
-        if (node == nullptr)  
-            return nullptr;  
-    
-        if (rank < node->rank)
-            return search(node->left, rank);
-        else if(rank > node->rank)
-            return search(node->right, rank - node->rank);
-        else
-            return node;
+        rmq_memory res;
+        res.nodes = static_cast<size_t>(n_nodes) * sizeof(node_t);
+        res.slack = pool != nullptr ? (pool->capacity() - pool->size()) * sizeof(node_t) : 0;
+        res.index = frozen != nullptr ? frozen->memory_usage() : 0;
+        return res;
     }
-    
 
     /*!
-     * Update the element of key rank in the subtree rooted in this node.
-     * @param  rank  the rank of the element we look for.
-     * @param  value the new value of the element.
-     * @return       the element in the tree.
+     * Access the array. The returned reference reads the element when it is
+     * converted to S, and updates it when it is assigned.
+     * @param rank  the rank of the element to be accessed.
      */
-    void update(node_t* node, K rank, const S value)
+    inline value_ref operator[](K rank)
     {
-        // If node is null, create one
-        if (node == nullptr)  
-            return;  
-
-        const K node_rank = node->rank;
-
-        node_t* ret = node;
-
-        if (rank < node_rank)
-            update(node->left, rank, value);
-        else if(rank > node_rank)
-            update(node->right, rank - node_rank, value);
-        else
-            node->value = value;
-
-        // Update minimum
-        node->update_min();
-
-        return;
+        return value_ref(this, rank);
     }
-    
 
     /*!
-     * Insert the value in the tree with rank rank. The elemnt with the same rank 
-     * is moved on the right. 
+     * Access the array. 
+     * @param rank  the rank of the element to be accessed.
+     * @return      the value, or 0 if rank is not smaller than size().
+     */
+    S access(K rank)
+    {
+        typename Stats::timer scope(stats, RMQ_ACCESS);
+        if(frozen != nullptr)
+            return rank < n_nodes ? (*frozen)[rank] : 0;
+        if(root == nullptr or rank >= n_nodes )
+            return 0;
+        auto ret = prefetch ? search<true>(root,rank) : search<false>(root,rank);
+        return ret->value;
+    }
+
+    /*!
+     * Access the value stored in the tree, without copies. The reference is
+     * valid until the next modification of the tree. If Op stores the values
+     * in a narrower type than S, the value is returned widened, by value.
+     * @param rank  the rank of the element to be accessed, smaller than size().
+     */
+    const_reference at(K rank)
+    {
+        assert(rank < n_nodes);
+        typename Stats::timer scope(stats, RMQ_ACCESS);
+        return (prefetch ? search<true>(root,rank) : search<false>(root,rank))->value;
+    }
+
+    /*!
+     * Insert the value in the tree with rank rank. The elemnt with the same rank 
+     * is moved on the right. 
+     * @param rank  the rank of the element that has to be inserted.
+     * @param value the value information attached to the element.
+     */
+    inline void insert(K rank, const S& value)
+    {
+        emplace(rank, value);
+    }
+
+    inline void insert(K rank, S&& value)
+    {
+        emplace(rank, std::move(value));
+    }
+
+    /*!
+     * Insert in the tree with rank rank the value constructed in place from 
+     * args. The elemnt with the same rank is moved on the right. 
+     * @param rank  the rank of the element that has to be inserted.
+     * @param args  the arguments forwarded to the constructor of the value.
+     */
+    template< typename... Args>
+    void emplace(K rank, Args&&... args)
+    {
+        typename Stats::timer scope(stats, RMQ_INSERT);
+        thaw();
+        if(rank > n_nodes)
+            rank = n_nodes;
+        node_t* leaf = get_pool().create(emplace_tag(), std::forward<Args>(args)...);
+        root = insert(root,rank,leaf);
+        n_nodes ++;
+        stats.depth(get_depth(root));
+    }
+
+    /*!
+     * Update the value in the tree with rank rank. 
      * @param rank  the rank of the element that has to be inserted.
      * @param value the value information attached to the element.
      */
-    node_t* insert(node_t* node, K rank, const S value)
+    inline void update(K rank, const S& value)
+    {
+        typename Stats::timer scope(stats, RMQ_UPDATE);
+        thaw();
+        update(root,rank,value);
+    }
+
+    inline void update(K rank, S&& value)
+    {
+        typename Stats::timer scope(stats, RMQ_UPDATE);
+        thaw();
+        update(root,rank,std::move(value));
+    }
+
+    /*!
+     * Insert a batch of m values. The ranks refer to the array before the
+     * insertion and must be sorted in non-decreasing order: each value is
+     * inserted before the element with its rank, and values with the same rank
+     * keep their order in the batch. The batch is split along the tree and each 
+     * subtree is joined back once, in time O(m log(n/m + 1)). The new nodes
+     * are allocated in a single block.
+     * @param edits the pairs (rank, value) to be inserted.
+     * @param m     the number of pairs.
+     */
+    void insert_batch(const std::pair<K,S>* edits, size_t m)
+    {
+        typename Stats::timer scope(stats, RMQ_INSERT_BATCH, m);
+        thaw();
+        if(m == 0)
+            return;
+        assert(std::is_sorted(edits, edits + m, rank_less()));
+
+        node_t* block = get_pool().allocate_block(m);
+        root = insert_batch(root, n_nodes, edits, edits + m, 0, block);
+        n_nodes += static_cast<K>(m);
+        stats.depth(get_depth(root));
+    }
+
+    /*!
+     * Update a batch of m values, in a single multi-path descent. The ranks
+     * must be sorted in non-decreasing order, if a rank is repeated the last
+     * value is kept. The aggregate of each visited node is computed once.
+     * @param edits the pairs (rank, value) to be updated.
+     * @param m     the number of pairs.
+     */
+    void update_batch(const std::pair<K,S>* edits, size_t m)
+    {
+        typename Stats::timer scope(stats, RMQ_UPDATE_BATCH, m);
+        thaw();
+        assert(std::is_sorted(edits, edits + m, rank_less()));
+        update_batch(root, edits, edits + m, 0);
+    }
+
+    /*!
+     * Add delta to the values in the interval [left, right), in time 
+     * O(log n). Requires an aggregate wrapped in rmq_lazy.
+     * @param left  the left boundary interval (includisve).
+     * @param right the right boundary of the interval (exclusive).
+     * @param delta the increment.
+     */
+    void range_add(K left, K right, const S& delta)
+    {
+        static_assert(lazy_t::value, "range_add requires an aggregate wrapped in rmq_lazy");
+        thaw();
+        if(right > n_nodes)
+            right = n_nodes;
+        typename Stats::timer scope(stats, RMQ_RANGE_UPDATE, left < right ? static_cast<size_t>(right - left) : 0);
+        if(left >= right)
+            return;
+        apply_range(root, left, right, false, S(), delta);
+    }
+
+    /*!
+     * Set the values in the interval [left, right) to value, in time 
+     * O(log n). Requires an aggregate wrapped in rmq_lazy.
+     * @param left  the left boundary interval (includisve).
+     * @param right the right boundary of the interval (exclusive).
+     * @param value the new value.
+     */
+    void range_assign(K left, K right, const S& value)
+    {
+        static_assert(lazy_t::value, "range_assign requires an aggregate wrapped in rmq_lazy");
+        thaw();
+        if(right > n_nodes)
+            right = n_nodes;
+        typename Stats::timer scope(stats, RMQ_RANGE_UPDATE, left < right ? static_cast<size_t>(right - left) : 0);
+        if(left >= right)
+            return;
+        apply_range(root, left, right, true, value, S(0));
+    }
+
+    /*!
+     * Remove the element in the tree with rank rank. The elements on its right
+     * are moved on the left.
+     * @param rank  the rank of the element that has to be removed.
+     */
+    void erase(K rank)
+    {
+        typename Stats::timer scope(stats, RMQ_ERASE);
+        thaw();
+        if(rank >= n_nodes)
+            return;
+        root = erase(root, rank);
+        n_nodes --;
+        stats.depth(get_depth(root));
+    }
+
+    /*!
+     * Remove the elements in the interval [left, right), by splitting the tree
+     * twice and joining the two sides. The structural work is O(log n), while
+     * the k removed nodes are returned to the pool in O(k).
+     * @param left  the left boundary interval (includisve).
+     * @param right the right boundary of the interval (exclusive).
+     */
+    void erase(K left, K right)
+    {
+        thaw();
+        if(right > n_nodes)
+            right = n_nodes;
+        typename Stats::timer scope(stats, RMQ_ERASE_RANGE, left < right ? static_cast<size_t>(right - left) : 0);
+        if(left >= right)
+            return;
+
+        node_t *l, *m, *r;
+        split(root, left, l, r);
+        split(r, right - left, m, r);
+        destroy(m);
+        root = join(l, left, r);
+        n_nodes -= right - left;
+        stats.depth(get_depth(root));
+    }
+
+    /*!
+     * Split the array in the first rank elements and the remaining ones, in
+     * time O(log n). The tree is left empty, and the two trees share its pool.
+     * @param rank  the number of elements of the first tree.
+     * @return      the pair of trees.
+     */
+    std::pair<avl_rmq, avl_rmq> split(K rank)
+    {
+        typename Stats::timer scope(stats, RMQ_SPLIT);
+        thaw();
+        if(rank > n_nodes)
+            rank = n_nodes;
+
+        std::pair<avl_rmq, avl_rmq> res;
+        split(root, rank, res.first.root, res.second.root);
+        res.first.n_nodes = rank;
+        res.second.n_nodes = n_nodes - rank;
+        res.first.pool = pool;
+        res.second.pool = std::move(pool);
+
+        root = nullptr;
+        n_nodes = 0;
+        return res;
+    }
+
+    /*!
+     * Concatenate two arrays, in time O(log n). The two trees are left empty,
+     * and the pool of right is merged into the pool of the result.
+     * @param left  the tree with the first elements.
+     * @param right the tree with the last elements.
+     * @return      the joined tree.
+     */
+    static avl_rmq join(avl_rmq&& left, avl_rmq&& right)
+    {
+        avl_rmq res(std::move(left));
+        res.thaw();
+        if(right.root == nullptr)
+            return res;
+
+        {
+            // The timer records in res before it is returned.
+            typename Stats::timer scope(res.stats, RMQ_JOIN);
+            if(res.pool == nullptr)
+                res.pool = std::move(right.pool);
+            else
+                res.pool->merge(*right.pool);
+            res.root = res.join(res.root, res.n_nodes, right.root);
+            res.n_nodes += right.n_nodes;
+        }
+        right.root = nullptr;
+        right.n_nodes = 0;
+        right.pool.reset();
+        right.thaw();
+        return res;
+    }
+
+    /*!
+     * Computes the aggregate of the interval [left, right), by default its 
+     * minimum.
+     * @param left  the left boundary interval (includisve).
+     * @param right the right boundary of the interval (exclusive).
+     */
+    agg_t operator ()(K left, K right)
+    {
+        typename Stats::timer scope(stats, RMQ_QUERY);
+        if(right > n_nodes)
+            right = n_nodes;
+        if(left >= right)
+            return Op::identity();
+        if(left == 0 and right == n_nodes)
+            return get_agg(root);
+        if(frozen != nullptr)
+            return (*frozen)(left, right);
+        if(prefetch)
+            return min_range<true>(root, left, right);
+        return min_range<false>(root, left, right);
+    }
+
+    /*!
+     * Computes the minimum in the interval [left, right) and the rank of its
+     * leftmost occurrence, in a single traversal. Requires a selection 
+     * aggregate, and the minimum is taken with respect to Op::less.
+     * @param left  the left boundary interval (includisve).
+     * @param right the right boundary of the interval (exclusive).
+     * @return      the pair (minimum, rank). If the interval is empty, the
+     *              rank is the size of the array.
+     */
+    std::pair<S,K> min_with_pos(K left, K right)
+    {
+        typename Stats::timer scope(stats, RMQ_SEARCH);
+        if(right > n_nodes)
+            right = n_nodes;
+        if(left >= right)
+            return std::make_pair(Op::identity(), n_nodes);
+        if(left == 0 and right == n_nodes)
+            return std::make_pair(get_agg(root), leftmost_min(root));
+        return min_with_pos(root, left, right);
+    }
+
+    /*!
+     * Computes the rank of the leftmost minimum in the interval [left, right).
+     * @param left  the left boundary interval (includisve).
+     * @param right the right boundary of the interval (exclusive).
+     * @return      the rank, or the size of the array if the interval is empty.
+     */
+    K argmin(K left, K right)
+    {
+        return min_with_pos(left, right).second;
+    }
+
+    /*!
+     * Finds the first element at or after start whose value is smaller than 
+     * threshold, in O(log n) time. Requires a selection aggregate, and the 
+     * values are compared with Op::less.
+     * @param start     the rank where the search starts.
+     * @param threshold the threshold.
+     * @return          the rank of the element, or the size of the array if
+     *                  there is no such element.
+     */
+    K find_first_below(K start, const S& threshold)
+    {
+        typename Stats::timer scope(stats, RMQ_SEARCH);
+        if(start >= n_nodes or !Op::less(get_agg(root), threshold))
+            return n_nodes;
+        return first_below(root, start, threshold);
+    }
+
+    /*!
+     * Finds the last element at or before end whose value is smaller than 
+     * threshold, in O(log n) time. Requires a selection aggregate, and the 
+     * values are compared with Op::less.
+     * @param end       the rank where the search starts.
+     * @param threshold the threshold.
+     * @return          the rank of the element, or the size of the array if
+     *                  there is no such element.
+     */
+    K find_last_below(K end, const S& threshold)
+    {
+        typename Stats::timer scope(stats, RMQ_SEARCH);
+        if(n_nodes == 0 or !Op::less(get_agg(root), threshold))
+            return n_nodes;
+        if(end >= n_nodes)
+            end = n_nodes - 1;
+        return last_below(root, end, threshold);
+    }
+
+
+    /*!
+     * Computes the aggregates of the intervals [ranges[i].first, ranges[i].second)
+     * for i in [0, m). The intervals are sorted by left boundary, so that
+     * consecutive descents share their upper paths, and are answered by groups 
+     * of batch_width interleaved descents. Each descent prefetches its next 
+     * node, so that the memory latency of a descent is hidden by the others.
+     * @param ranges  the intervals.
+     * @param m       the number of intervals.
+     * @param out     the array where to store the m aggregates.
+     */
+    void query_batch(const std::pair<K,K>* ranges, size_t m, agg_t* out)
+    {
+        typename Stats::timer scope(stats, RMQ_QUERY_BATCH, m);
+        std::vector< std::pair<K,size_t> > order;
+        order.reserve(m);
+        for(size_t i = 0; i < m; ++i)
+        {
+            K left = ranges[i].first;
+            K right = std::min(ranges[i].second, n_nodes);
+            if(left >= right)
+                out[i] = Op::identity();
+            else if(left == 0 and right == n_nodes)
+                out[i] = get_agg(root);
+            else if(frozen != nullptr)
+                out[i] = (*frozen)(left, right);
+            else
+                order.push_back(std::make_pair(left, i));
+        }
+        std::sort(order.begin(), order.end());
+
+        range_cursor cursors[batch_width];
+        size_t next = 0;
+        size_t active = 0;
+        for(; active < batch_width and next < order.size(); ++active, ++next)
+            cursors[active].start(root, ranges[order[next].second], n_nodes, order[next].second);
+
+        while(active > 0)
+        {
+            for(size_t i = 0; i < active; )
+            {
+                range_cursor& c = cursors[i];
+                if(c.step(this))
+                {
+                    __builtin_prefetch(c.node);
+                    ++i;
+                    continue;
+                }
+                out[c.id] = c.agg;
+                if(next < order.size())
+                {
+                    c.start(root, ranges[order[next].second], n_nodes, order[next].second);
+                    ++next;
+                    ++i;
+                }
+                else
+                    c = cursors[--active];
+            }
+        }
+    }
+
+    /*!
+     * @return the iterator to the first element of the array.
+     */
+    iterator begin()
+    {
+        iterator it(this, 0);
+        it.leftmost(root);
+        return it;
+    }
+
+    /*!
+     * @return the iterator past the last element of the array.
+     */
+    inline iterator end()
+    {
+        return iterator(this, n_nodes);
+    }
+
+    /*!
+     * @param rank  the rank of the element.
+     * @return      the iterator to the element, in time O(log n), or end() if
+     *              rank is not smaller than size().
+     */
+    iterator iterator_at(K rank)
+    {
+        if(rank >= n_nodes)
+            return end();
+        iterator it(this, rank);
+        node_t* node = root;
+        while(node != nullptr)
+        {
+            push(node);
+            it.path.push_back(node);
+            if(rank < node->rank)
+                node = node->left;
+            else if(rank > node->rank)
+            {
+                rank -= node->rank + 1;
+                node = node->right;
+            }
+            else
+                break;
+        }
+        return it;
+    }
+
+    /*!
+     * Calls f on each value in the interval [left, right), in order, in time
+     * O(log n + right - left), without copying the values.
+     * @param left  the left boundary interval (includisve).
+     * @param right the right boundary of the interval (exclusive).
+     * @param f     the function called as f(const S&).
+     */
+    template< typename F>
+    void for_each(K left, K right, F f)
+    {
+        if(right > n_nodes)
+            right = n_nodes;
+        if(left < right)
+            for_each(root, left, right, f);
+    }
+
+    /*!
+     * Access the i-th child of the node.
+     * @param i the index of the child to be returned
+     * @return  the i-th child of the node if it exists.
+     */
+    std::vector<S> to_vector()
+    {
+        std::vector<S> res;
+        to_vector(root, res);
+        return res;
+    }
+
+    /*!
+     * Converts the tree into an std::vector, filling disjoint slices of the
+     * output from up to n_threads threads.
+     * @param n_threads the maximum number of threads used.
+     */
+    std::vector<S> to_vector(size_t n_threads)
+    {
+        std::vector<S> res(static_cast<size_t>(n_nodes));
+        to_vector(root, res.data(), n_threads);
+        return res;
+    }
+
+    /*!
+     * Write the binary image of the array: the values in order followed by the
+     * aggregates of the blocks of the array, see rmq_image.hpp. The image can
+     * be read back with load, or memory mapped by mapped_rmq. The values and
+     * the aggregates must be trivially copyable.
+     * @param out the output stream.
+     * @return    false if the output failed.
+     */
+    bool serialize(std::ostream& out)
+    {
+        rmq_image_writer<K,S,Op> writer(out, n_nodes);
+        serialize(root, writer);
+        return writer.finish();
+    }
+
+    /*!
+     * Replace the content of the tree with the array stored in a binary image
+     * written by serialize, in linear time.
+     * @param in the input stream.
+     * @return   false if the image is not valid, in which case the tree is
+     *           left empty.
+     */
+    bool load(std::istream& in)
+    {
+        rmq_image_reader<K,S,Op> reader(in);
+        release();
+        if(not reader.good())
+            return false;
+        const size_t n = static_cast<size_t>(reader.size());
+        if(n > 0)
+        {
+            node_t* block = get_pool().allocate_block(n);
+            root = build(block, n, reader);
+            n_nodes = static_cast<K>(n);
+        }
+        reader.finish();
+        if(not reader.good())
+        {
+            release();
+            return false;
+        }
+        return true;
+    }
+
+    /*!
+     * Print the tree.
+     */
+    void print()
+    {
+        print(root);
+        std::cout << std::endl;
+    }
+
+    /*!
+     * Check the invariants of the tree, in linear time: the rank of each node
+     * is the size of its left subtree, its aggregate and its depth match the
+     * ones of its children, whose depths differ by at most one, and the tree
+     * stores size() elements. The aggregates are compared exactly. The 
+     * pending range updates are pushed down during the visit.
+     * @return true if all the invariants hold.
+     */
+    bool check_integrity()
+    {
+        size_t size = 0;
+        if(not check_integrity(root, size))
+            return false;
+        return size == static_cast<size_t>(n_nodes) and (root == nullptr or pool != nullptr);
+    }
+
+  protected:
+
+    static const size_t max_height = 128; // Bound on the depth of an AVL tree with 2^64 nodes.
+    static const size_t batch_width = 16; // Number of interleaved descents in query_batch.
+    static const size_t parallel_cutoff = 1 << 16; // Smallest subtree split between threads.
+
+    /*!
+     * Compares the ranks of two edits.
+     */
+    struct rank_less{
+        inline bool operator()(const std::pair<K,S>& a, const std::pair<K,S>& b) const
+        {
+            return a.first < b.first;
+        }
+    };
+
+    /*!
+     * Iterator over the values of a range of edits.
+     */
+    struct edit_value_iterator{
+        const std::pair<K,S>* it;
+
+        inline const S& operator*() const { return it->second; }
+        inline edit_value_iterator& operator++() { ++it; return *this; }
+    };
+
+    /*!
+     * State of a min_range descent that can be advanced one node at a time.
+     */
+    typedef struct range_cursor{
+        node_t* node;     // The next node to visit.
+        node_t* split;    // The node splitting the interval.
+        K left;           // The left boundary relative to node.
+        K right;          // The right boundary relative to node.
+        agg_t agg;        // The aggregate of the pieces found so far.
+        size_t id;        // The index of the query.
+        uint8_t phase;    // 0: looking for split, 1: left boundary, 2: right boundary.
+
+        range_cursor():
+            node(nullptr), split(nullptr), left(0), right(0), agg(), id(0), phase(0)
+        {
+
+        }
+
+        inline void start(node_t* root, const std::pair<K,K>& range, K n, size_t id_)
+        {
+            node = root;
+            split = nullptr;
+            left = range.first;
+            right = std::min(range.second, n);
+            agg = Op::identity();
+            id = id_;
+            phase = 0;
+        }
+
+        /*!
+         * Visit the next node, following the same steps of min_range. The
+         * pieces of the left boundary are prepended to the aggregate, the ones
+         * of the right boundary are appended.
+         * @return false if the descent is over.
+         */
+        inline bool step(avl_rmq* tree)
+        {
+            tree->push(node);
+            switch(phase)
+            {
+            case 0:
+                if(node->rank >= right)
+                    node = node->left;
+                else if(node->rank < left)
+                {
+                    left -= node->rank + 1;
+                    right -= node->rank + 1;
+                    node = node->right;
+                }
+                else
+                {
+                    split = node;
+                    agg = Op::lift(node->value);
+                    right -= node->rank + 1;
+                    node = node->left;
+                    phase = 1;
+                }
+                return true;
+            case 1:
+                if(node == nullptr or left == 0)
+                {
+                    if(node != nullptr)
+                        agg = Op::combine(node->agg, agg);
+                    node = split->right;
+                    phase = 2;
+                }
+                else if(left <= node->rank)
+                {
+                    agg = Op::combine(Op::lift(node->value), Op::combine(tree->get_agg(node->right), agg));
+                    node = node->left;
+                }
+                else
+                {
+                    left -= node->rank + 1;
+                    node = node->right;
+                }
+                return true;
+            default:
+                if(node == nullptr or right == 0)
+                    return false;
+                if(right > node->rank)
+                {
+                    agg = Op::combine(Op::combine(agg, tree->get_agg(node->left)), Op::lift(node->value));
+                    right -= node->rank + 1;
+                    node = node->right;
+                }
+                else
+                    node = node->left;
+                return true;
+            }
+        }
+    }range_cursor;
+ 
+    /*!
+     * Return the depth of the node
+     * @return true if the node is a leaf, false otherwise
+     */
+    inline const d_t get_depth(node_t* node)
+    {
+        if(node == nullptr)
+            return 0;
+        return node->depth;
+    }
+
+    /*!
+     * Return the aggregate of the subtree
+     * @return the identity if the subtree is empty
+     */
+    inline const agg_t get_agg(node_t* node)
+    {
+        if(node == nullptr)
+            return Op::identity();
+        return node->agg;
+    }
+
+    /*!
+     * Push the pending range update of the node to its children. The node
+     * must be pushed before its children are read or modified.
+     * @param node  the node, possibly null.
+     */
+    inline void push(node_t* node)
+    {
+        push(node, lazy_t());
+    }
+
+    inline void push(node_t*, std::false_type) { }
+
+    void push(node_t* node, std::true_type)
+    {
+        if(node == nullptr or (not node->has_set and node->add == S(0)))
+            return;
+        if(node->left != nullptr)
+            apply(node->left, node->has_set, node->set, node->add);
+        if(node->right != nullptr)
+            apply(node->right, node->has_set, node->set, node->add);
+        node->has_set = false;
+        node->add = S(0);
+    }
+
+    /*!
+     * Apply a range update to the whole subtree rooted in node: the value and
+     * the aggregate of the node are updated, and the update is left pending
+     * for the children.
+     * @param node    the root of the subtree.
+     * @param has_set whether the values are assigned.
+     * @param set     the value assigned, if has_set.
+     * @param add     the increment, applied after the assignment.
+     */
+    void apply(node_t* node, bool has_set, const S& set, const S& add)
+    {
+        if(has_set)
+        {
+            node->value = narrow_t::store(set);
+            node->agg = narrow_agg_t::store(Op::assign(set, static_cast<size_t>(node->size)));
+            node->has_set = true;
+            node->set = set;
+            node->add = add;
+        }
+        else
+            node->add = node->add + add;
+        node->value = narrow_t::store(static_cast<S>(node->value) + add);
+        node->agg = narrow_agg_t::store(Op::add(node->agg, add, static_cast<size_t>(node->size)));
+    }
+
+    /*!
+     * Apply a range update to the elements [left, right) of the subtree
+     * rooted in node, with left < right <= size of the subtree. The update is
+     * left pending in the O(log n) maximal subtrees covered by the interval.
+     * @param node    the root of the subtree.
+     * @param left    the left boundary interval (includisve).
+     * @param right   the right boundary of the interval (exclusive).
+     * @param has_set whether the values are assigned.
+     * @param set     the value assigned, if has_set.
+     * @param add     the increment, applied after the assignment.
+     */
+    void apply_range(node_t* node, K left, K right, bool has_set, const S& set, const S& add)
+    {
+        if(left == 0 and right == node->size)
+        {
+            apply(node, has_set, set, add);
+            return;
+        }
+        push(node);
+        const K node_rank = node->rank;
+        if(left < node_rank)
+            apply_range(node->left, left, std::min(right, node_rank), has_set, set, add);
+        if(left <= node_rank and node_rank < right)
+            node->value = narrow_t::store((has_set ? set : static_cast<S>(node->value)) + add);
+        if(right > node_rank + 1)
+            apply_range(node->right, (left > node_rank ? left - node_rank - 1 : 0), right - node_rank - 1, has_set, set, add);
+        node->update_agg();
+    }
+  
+    /*!
+     * Return the depth of the node
+     * @return true if the node is a leaf, false otherwise
+     */
+    inline const int8_t get_balance(node_t* node)
+    {
+        if(node == nullptr)
+            return 0;
+        return get_depth(node->left) - get_depth(node->right);
+    }
+
+  
+    /*!
+     * Rotate the subtree to the right.
+     * @return the new root.
+     */
+    node_t* right_rotate(node_t* y)
+    {
+        node_t *x = y->left;  
+        stats.rotation();
+        push(y);
+        push(x);
+        node_t *tmp = x->right;  
+    
+        // Perform rotation  
+        x->right = y;  
+        y->left = tmp;  
+
+        // Update ranks
+        y->rank -= x->rank + 1;
+
+        // Update aggregates
+        x->copy_agg(*y);
+        y->update_agg();
+    
+        // Update heights  
+        y->depth = std::max(get_depth(y->left), get_depth(y->right)) + 1;  
+        x->depth = std::max(get_depth(x->left), get_depth(x->right)) + 1;  
+    
+        // Return new root  
+        return x;   
+    }
+
+    /*!
+     * Rotate the subtree to the left.
+     * @return the new root.
+     */
+    node_t* left_rotate(node_t* x)
+    {
+        node_t *y = x->right;  
+        stats.rotation();
+        push(x);
+        push(y);
+        node_t *tmp = y->left;  
+    
+        // Perform rotation  
+        y->left = x;  
+        x->right = tmp;  
+
+        // Update ranks
+        y->rank += x->rank + 1;
+
+        // Update aggregates
+        y->copy_agg(*x);
+        x->update_agg();
+
+        // Update heights  
+        x->depth = std::max(get_depth(x->left), get_depth(x->right)) + 1;  
+        y->depth = std::max(get_depth(y->left), get_depth(y->right)) + 1;  
+    
+        // Return new root  
+        return y;   
+
+    }
+
+    /*!
+     * Issues the loads of the children of the node, if prefetching is true.
+     */
+    template< bool prefetching>
+    static inline void prefetch_children(const node_t* node)
+    {
+        if(prefetching)
+        {
+            __builtin_prefetch(node->left);
+            __builtin_prefetch(node->right);
+        }
+    }
+
+    /*!
+     * Finds the element of key rank in the subtree rooted in this node.
+     * @param  rank the rank of the element we look for.
+     * @return      the element in the tree.
+     */
+    template< bool prefetching = false>
+    node_t* search(node_t* node, K rank)
+    {
+        while (node != nullptr)
+        {
+            prefetch_children<prefetching>(node);
+            stats.visit(RMQ_ACCESS);
+            push(node);
+            if (rank < node->rank)
+                node = node->left;
+            else if(rank > node->rank)
+            {
+                rank -= node->rank + 1;
+                node = node->right;
+            }
+            else
+                break;
+        }
+        return node;
+    }
+    
+
+    /*!
+     * Update the element of key rank in the subtree rooted in this node.
+     * The path to the element is recorded during a single descent, then the
+     * aggregates are fixed bottom-up until they stop changing.
+     * @param  rank  the rank of the element we look for.
+     * @param  value the new value of the element.
+     */
+    template< typename V>
+    void update(node_t* node, K rank, V&& value)
     {
-        // If node is null, create one
+        node_t* path[max_height];
+        size_t length = 0;
+
+        while (node != nullptr)
+        {
+            push(node);
+            path[length++] = node;
+            if (rank < node->rank)
+                node = node->left;
+            else if(rank > node->rank)
+            {
+                rank -= node->rank + 1;
+                node = node->right;
+            }
+            else
+                break;
+        }
+        stats.visit(RMQ_UPDATE, length);
+
         if (node == nullptr)  
-            return (new node_t(rank, value, value));  
+            return;  
+
+        node->value = narrow_t::store(std::forward<V>(value));
+
+        // Update aggregates
+        while(length > 0)
+        {
+            node_t* curr = path[--length];
+            const agg_t old_agg = curr->agg;
+            if(curr->update_agg() == old_agg)
+                break;
+        }
+    }
     
-        if (rank <= node->rank)
+
+    /*!
+     * Insert the value in the tree with rank rank. The elemnt with the same rank 
+     * is moved on the right. 
+     * The ranks are updated during the descent, then the path is rebalanced
+     * bottom-up until the depths stop changing. The aggregates are fixed 
+     * bottom-up along the whole path.
+     * @param rank  the rank of the element that has to be inserted.
+     * @param leaf  the new node, storing the inserted value.
+     * @return      the new root of the subtree.
+     */
+    node_t* insert(node_t* node, K rank, node_t* leaf)
+    {
+        node_t** path[max_height];
+        size_t length = 0;
+
+        node_t** link = &node;
+        while (*link != nullptr)
         {
-            node->left = insert(node->left, rank, value);  
-            node->rank++;
-        }  
-        else
-            node->right = insert(node->right, rank - node->rank, value);  // The rank is decreased to match the one of the child
+            node_t* curr = *link;
+            push(curr);
+            path[length++] = link;
+
+            if (rank <= curr->rank)
+            {
+                curr->rank++;
+                link = &curr->left;
+            }
+            else
+            {
+                rank -= curr->rank + 1;  // The rank is decreased to match the one of the child
+                link = &curr->right;
+            }
+        }
+        *link = leaf;
+        stats.visit(RMQ_INSERT, length);
+
+        while(length > 0)
+        {
+            link = path[--length];
+            const d_t depth = (*link)->depth;
+            (*link)->update_agg();
+            *link = rebalance(*link);
+            if((*link)->depth == depth)
+                break;
+        }
+        while(length > 0)
+            (*path[--length])->update_agg();
+
+        return node;
+    }
+
+    /*!
+     * Insert the sorted edits [first, last) in the subtree rooted in node.
+     * @param node    the root of the subtree.
+     * @param size    the number of elements of the subtree.
+     * @param first   the first edit.
+     * @param last    the end of the edits.
+     * @param offset  the rank of the first element of the subtree in the array.
+     * @param block   the memory for the new nodes, advanced by last - first.
+     * @return        the new root of the subtree.
+     */
+    node_t* insert_batch(node_t* node, K size, const std::pair<K,S>* first, const std::pair<K,S>* last, K offset, node_t*& block)
+    {
+        if(first == last)
+            return node;
+        if(node == nullptr)
+        {
+            const size_t m = static_cast<size_t>(last - first);
+            edit_value_iterator it = {first};
+            node = build(block, m, it);
+            block += m;
+            return node;
+        }
+
+        // The edits with the rank of the node are inserted before it.
+        push(node);
+        const K node_rank = node->rank;
+        const std::pair<K,S>* mid = std::upper_bound(first, last, std::make_pair(offset + node_rank, S()), rank_less());
+        node_t* left = insert_batch(node->left, node_rank, first, mid, offset, block);
+        node_t* right = insert_batch(node->right, size - node_rank - 1, mid, last, offset + node_rank + 1, block);
+        return join(left, node_rank + static_cast<K>(mid - first), node, right);
+    }
 
-        // Update min
-        node->min = std::min(node->min, value);
+    /*!
+     * Update the elements of the subtree rooted in node with the sorted edits
+     * [first, last).
+     * @param node    the root of the subtree.
+     * @param first   the first edit.
+     * @param last    the end of the edits.
+     * @param offset  the rank of the first element of the subtree in the array.
+     */
+    void update_batch(node_t* node, const std::pair<K,S>* first, const std::pair<K,S>* last, K offset)
+    {
+        if(node == nullptr or first == last)
+            return;
+
+        push(node);
+        const K node_rank = offset + node->rank;
+        const std::pair<K,S>* mid = std::lower_bound(first, last, std::make_pair(node_rank, S()), rank_less());
+        update_batch(node->left, first, mid, offset);
+        for(; mid != last and mid->first == node_rank; ++mid)
+            node->value = narrow_t::store(mid->second);
+        update_batch(node->right, mid, last, node_rank + 1);
+
+        node->update_agg();
+    }
 
+    /*!
+     * Update the depth of the node and rotate the subtree if unbalanced. The
+     * subtrees of the node must be balanced, and their depths must differ by
+     * at most two.
+     * @param node  the root of the subtree.
+     * @return      the new root of the subtree.
+     */
+    node_t* rebalance(node_t* node)
+    {
         // Update depth
         node->depth = std::max(get_depth(node->left),  get_depth(node->right)) + 1;  
     
@@ -390,7 +1780,7 @@ public:
         if (balance > 1)
         {
             // Left Right Case  
-            if(rank > node->left->rank)  
+            if(get_balance(node->left) < 0)  
                 node->left = left_rotate(node->left);  
 
             // Left Left Case  
@@ -399,9 +1789,8 @@ public:
 
         if (balance < -1)
         {  
-            rank -= node->rank; // Update the rank value
             // Right Left Case  
-            if ( rank < node->right->rank )
+            if (get_balance(node->right) > 0)
                 node->right = right_rotate(node->right);  
 
             // Right Right Case  
@@ -412,45 +1801,537 @@ public:
     }
 
     /*!
-     * Computes the minimum in the interval [left, right).
+     * Remove the element with rank rank from the subtree rooted in node.
+     * @param node  the root of the subtree.
+     * @param rank  the rank of the element that has to be removed.
+     * @return      the new root of the subtree.
+     */
+    node_t* erase(node_t* node, K rank)
+    {
+        stats.visit(RMQ_ERASE);
+        push(node);
+        if (rank < node->rank)
+        {
+            node->left = erase(node->left, rank);
+            node->rank--;
+        }
+        else if (rank > node->rank)
+            node->right = erase(node->right, rank - node->rank - 1);
+        else
+        {
+            node_t* tmp = node;
+            if(node->left == nullptr or node->right == nullptr)
+            {
+                node = (node->left != nullptr ? node->left : node->right);
+                pool->destroy(tmp);
+                return node;
+            }
+            // Replace the node with its successor.
+            tmp->right = erase_min(tmp->right, node);
+            node->left = tmp->left;
+            node->right = tmp->right;
+            node->rank = tmp->rank;
+            pool->destroy(tmp);
+        }
+
+        node->update_agg();
+        return rebalance(node);
+    }
+
+    /*!
+     * Detach the first element of the subtree rooted in node.
+     * @param node  the root of the subtree.
+     * @param min   set to the detached node.
+     * @return      the new root of the subtree.
+     */
+    node_t* erase_min(node_t* node, node_t*& min)
+    {
+        push(node);
+        if (node->left == nullptr)
+        {
+            min = node;
+            return node->right;
+        }
+        node->left = erase_min(node->left, min);
+        node->rank--;
+        node->update_agg();
+        return rebalance(node);
+    }
+
+    /*!
+     * Detach the last element of the subtree rooted in node.
+     * @param node  the root of the subtree.
+     * @param max   set to the detached node.
+     * @return      the new root of the subtree.
+     */
+    node_t* erase_max(node_t* node, node_t*& max)
+    {
+        push(node);
+        if (node->right == nullptr)
+        {
+            max = node;
+            return node->left;
+        }
+        node->right = erase_max(node->right, max);
+        node->update_agg();
+        return rebalance(node);
+    }
+
+    /*!
+     * Join two subtrees with a middle node, such that the elements of left
+     * come before mid, and the elements of right come after mid. The cost is
+     * proportional to the difference of the depths of the two subtrees.
+     * @param left      the root of the left subtree.
+     * @param left_size the number of elements of the left subtree.
+     * @param mid       the middle node.
+     * @param right     the root of the right subtree.
+     * @return          the root of the joined tree.
+     */
+    node_t* join(node_t* left, K left_size, node_t* mid, node_t* right)
+    {
+        if(get_depth(left) > get_depth(right) + 1)
+        {
+            // Descend the right spine of left.
+            push(left);
+            left->right = join(left->right, left_size - left->rank - 1, mid, right);
+            left->update_agg();
+            return rebalance(left);
+        }
+        if(get_depth(right) > get_depth(left) + 1)
+        {
+            // Descend the left spine of right.
+            push(right);
+            right->left = join(left, left_size, mid, right->left);
+            right->rank += left_size + 1;
+            right->update_agg();
+            return rebalance(right);
+        }
+        push(mid);
+        mid->left = left;
+        mid->right = right;
+        mid->rank = left_size;
+        mid->update_agg();
+        return rebalance(mid);
+    }
+
+    /*!
+     * Join two subtrees, such that the elements of left come before the
+     * elements of right.
+     * @param left      the root of the left subtree.
+     * @param left_size the number of elements of the left subtree.
+     * @param right     the root of the right subtree.
+     * @return          the root of the joined tree.
+     */
+    node_t* join(node_t* left, K left_size, node_t* right)
+    {
+        if(left == nullptr)
+            return right;
+        if(right == nullptr)
+            return left;
+        node_t* mid;
+        left = erase_max(left, mid);
+        return join(left, left_size - 1, mid, right);
+    }
+
+    /*!
+     * Split the subtree rooted in node in the subtree of the first rank
+     * elements and the subtree of the remaining elements.
+     * @param node  the root of the subtree.
+     * @param rank  the number of elements of the left subtree.
+     * @param left  set to the root of the left subtree.
+     * @param right set to the root of the right subtree.
+     */
+    void split(node_t* node, K rank, node_t*& left, node_t*& right)
+    {
+        if(node == nullptr)
+        {
+            left = right = nullptr;
+            return;
+        }
+        push(node);
+        node_t* l = node->left;
+        node_t* r = node->right;
+        const K node_rank = node->rank;
+        if(rank <= node_rank)
+        {
+            split(l, rank, left, l);
+            right = join(l, node_rank - rank, node, r);
+        }
+        else
+        {
+            split(r, rank - node_rank - 1, r, right);
+            left = join(l, node_rank, node, r);
+        }
+    }
+
+    /*!
+     * Computes the aggregate of the interval [left, right), with left < right.
+     * First finds the node splitting the interval, then walks down the left
+     * and the right boundary paths. The pieces of the left boundary are
+     * visited from right to left and are prepended to the aggregate, the ones
+     * of the right boundary are appended.
      * @param node  the root of the tree.
      * @param left  the left boundary interval (includisve).
      * @param right the right boundary of the interval (exclusive).
-     * @param include_right tells if the subtree has to include its right subtree.
      */
-    S min_range(node_t* node, K left, K right, bool include_right = false)
+    template< bool prefetching = false>
+    agg_t min_range(node_t* node, K left, K right)
     {
-        // If node is null, create one
-        if (node == nullptr or left == right)  
-            return std::numeric_limits<S>::max();  
+        while (node != nullptr)
+        {
+            prefetch_children<prefetching>(node);
+            stats.visit(RMQ_QUERY);
+            push(node);
+            const K node_rank = node->rank;
+            // If the rank of the current node is larger than right, 
+            // the answer is in the left child.
+            if (node_rank >= right)
+                node = node->left;
+            // If the rank of the current node is smaller than left, 
+            // the answer is in the right child.
+            else if (node_rank < left)
+            {
+                left -= node_rank + 1;
+                right -= node_rank + 1;
+                node = node->right;
+            }
+            else
+                break;
+        }
 
-        const K node_rank = node->rank;
-        // If the rank of the current node is larger than right, 
-        // the answer is in the left child.
-        if (node_rank >= right)
-            return min_range(node->left,left,right);
-        // If the rank of the current node is smaller than left, 
-        // the answer is in the right child.
-        if (node_rank < left)
-            return min_range(node->right,left - node_rank,right - node_rank);
+        if (node == nullptr)  
+            return Op::identity();  
 
         // The range includes the current node.
+        agg_t agg = Op::lift(node->value);
+
+        // Left boundary: the suffix of the left subtree starting at left.
+        node_t* curr = node->left;
+        while (curr != nullptr)
+        {
+            prefetch_children<prefetching>(curr);
+            stats.visit(RMQ_QUERY);
+            push(curr);
+            // Check if the range cover the subtree, use its aggregate.
+            if (left == 0)
+            {
+                agg = Op::combine(curr->agg, agg);
+                break;
+            }
+            if (left <= curr->rank)
+            {
+                agg = Op::combine(Op::lift(curr->value), Op::combine(get_agg(curr->right), agg));
+                curr = curr->left;
+            }
+            else
+            {
+                left -= curr->rank + 1;
+                curr = curr->right;
+            }
+        }
+
+        // Right boundary: the prefix of the right subtree of length right.
+        right -= node->rank + 1;
+        curr = node->right;
+        while (curr != nullptr and right > 0)
+        {
+            prefetch_children<prefetching>(curr);
+            stats.visit(RMQ_QUERY);
+            push(curr);
+            if (right > curr->rank)
+            {
+                agg = Op::combine(Op::combine(agg, get_agg(curr->left)), Op::lift(curr->value));
+                right -= curr->rank + 1;
+                curr = curr->right;
+            }
+            else
+                curr = curr->left;
+        }
+
+        return agg;  
+    }
+
+    /*!
+     * Computes the minimum in the interval [left, right), with left < right,
+     * and the rank of its leftmost occurrence. Follows the same paths of
+     * min_range, keeping track of the piece (a node or a whole subtree) that
+     * supplies the minimum. If the piece is a subtree, the leftmost minimum
+     * is found by a single descent guided by the subtree minimums.
+     * @param node  the root of the tree.
+     * @param left  the left boundary interval (includisve).
+     * @param right the right boundary of the interval (exclusive).
+     */
+    std::pair<S,K> min_with_pos(node_t* node, K left, K right)
+    {
+        K base = 0; // Rank of the first element of the subtree of node.
+        while (node != nullptr)
+        {
+            push(node);
+            const K node_rank = node->rank;
+            if (node_rank >= right)
+                node = node->left;
+            else if (node_rank < left)
+            {
+                left -= node_rank + 1;
+                right -= node_rank + 1;
+                base += node_rank + 1;
+                node = node->right;
+            }
+            else
+                break;
+        }
+
+        if (node == nullptr)
+            return std::make_pair(Op::identity(), n_nodes);
+
         S min = node->value;
-        if(include_right)
-            min = std::min(min, get_min(node->right));
-        // Check if the range cover the left child, use left child's min.
-        if (left == 0)
-            min = std::min(min, get_min(node->left));
-        else
-            min = std::min(min, min_range(node->left,left,node_rank, true));
+        K pos = base + node->rank;    // Rank of the first element of the piece.
+        node_t* piece = nullptr;      // The subtree supplying min, if any.
+
+        // Left boundary: pieces are visited from right to left, hence ties
+        // are resolved in favour of the last visited one.
+        node_t* curr = node->left;
+        K curr_base = base;
+        while (curr != nullptr)
+        {
+            push(curr);
+            if (left == 0)
+            {
+                if (!Op::less(min, curr->agg))
+                {
+                    min = curr->agg;
+                    pos = curr_base;
+                    piece = curr;
+                }
+                break;
+            }
+            if (left <= curr->rank)
+            {
+                if (curr->right != nullptr and !Op::less(min, curr->right->agg))
+                {
+                    min = curr->right->agg;
+                    pos = curr_base + curr->rank + 1;
+                    piece = curr->right;
+                }
+                if (!Op::less(min, curr->value))
+                {
+                    min = curr->value;
+                    pos = curr_base + curr->rank;
+                    piece = nullptr;
+                }
+                curr = curr->left;
+            }
+            else
+            {
+                left -= curr->rank + 1;
+                curr_base += curr->rank + 1;
+                curr = curr->right;
+            }
+        }
+
+        // Right boundary: pieces are visited from left to right, hence ties
+        // are resolved in favour of the first visited one.
+        right -= node->rank + 1;
+        curr = node->right;
+        curr_base = base + node->rank + 1;
+        while (curr != nullptr and right > 0)
+        {
+            push(curr);
+            if (right > curr->rank)
+            {
+                if (curr->left != nullptr and Op::less(curr->left->agg, min))
+                {
+                    min = curr->left->agg;
+                    pos = curr_base;
+                    piece = curr->left;
+                }
+                if (Op::less(curr->value, min))
+                {
+                    min = curr->value;
+                    pos = curr_base + curr->rank;
+                    piece = nullptr;
+                }
+                right -= curr->rank + 1;
+                curr_base += curr->rank + 1;
+                curr = curr->right;
+            }
+            else
+                curr = curr->left;
+        }
+
+        if (piece != nullptr)
+            pos += leftmost_min(piece);
+        return std::make_pair(min, pos);
+    }
+
+    /*!
+     * Finds the first element at or after start smaller than threshold.
+     * The descent towards start records the nodes whose element and right 
+     * subtree follow start. They are then visited from the deepest one, i.e., 
+     * from left to right, and the first one containing a value smaller than 
+     * threshold is searched with a descent guided by the subtree minimums.
+     * @param node      the root of the tree.
+     * @param start     the rank where the search starts.
+     * @param threshold the threshold.
+     */
+    K first_below(node_t* node, K start, const S& threshold)
+    {
+        std::pair<node_t*,K> path[max_height];
+        size_t length = 0;
+        K base = 0;
+        while (node != nullptr)
+        {
+            push(node);
+            if (start - base <= node->rank)
+            {
+                path[length++] = std::make_pair(node, base);
+                node = node->left;
+            }
+            else
+            {
+                base += node->rank + 1;
+                node = node->right;
+            }
+        }
+
+        while (length > 0)
+        {
+            node = path[--length].first;
+            base = path[length].second;
+            if (Op::less(node->value, threshold))
+                return base + node->rank;
+            if (Op::less(get_agg(node->right), threshold))
+            {
+                base += node->rank + 1;
+                node = node->right;
+                // The subtree contains the answer.
+                while (true)
+                {
+                    push(node);
+                    if (Op::less(get_agg(node->left), threshold))
+                        node = node->left;
+                    else if (Op::less(node->value, threshold))
+                        return base + node->rank;
+                    else
+                    {
+                        base += node->rank + 1;
+                        node = node->right;
+                    }
+                }
+            }
+        }
+        return n_nodes;
+    }
 
-        min = std::min(min, min_range(node->right,0,right - node_rank, false));
+    /*!
+     * Finds the last element at or before end smaller than threshold.
+     * Symmetric to first_below.
+     * @param node      the root of the tree.
+     * @param end       the rank where the search starts.
+     * @param threshold the threshold.
+     */
+    K last_below(node_t* node, K end, const S& threshold)
+    {
+        std::pair<node_t*,K> path[max_height];
+        size_t length = 0;
+        K base = 0;
+        while (node != nullptr)
+        {
+            push(node);
+            if (base <= end and end - base >= node->rank)
+            {
+                path[length++] = std::make_pair(node, base);
+                base += node->rank + 1;
+                node = node->right;
+            }
+            else
+                node = node->left;
+        }
 
+        while (length > 0)
+        {
+            node = path[--length].first;
+            base = path[length].second;
+            if (Op::less(node->value, threshold))
+                return base + node->rank;
+            if (Op::less(get_agg(node->left), threshold))
+            {
+                node = node->left;
+                // The subtree contains the answer.
+                while (true)
+                {
+                    push(node);
+                    if (Op::less(get_agg(node->right), threshold))
+                    {
+                        base += node->rank + 1;
+                        node = node->right;
+                    }
+                    else if (Op::less(node->value, threshold))
+                        return base + node->rank;
+                    else
+                        node = node->left;
+                }
+            }
+        }
+        return n_nodes;
+    }
 
-        return min;  
+    /*!
+     * Computes the rank of the leftmost occurrence of the minimum of the 
+     * subtree rooted in node, relative to the subtree.
+     * @param node  the root of the subtree.
+     */
+    K leftmost_min(node_t* node)
+    {
+        const S min = get_agg(node);
+        K rank = 0;
+        while (node != nullptr)
+        {
+            push(node);
+            if (node->left != nullptr and !Op::less(min, node->left->agg))
+                node = node->left;
+            else if (!Op::less(min, node->value))
+                return rank + node->rank;
+            else
+            {
+                rank += node->rank + 1;
+                node = node->right;
+            }
+        }
+        return rank;
     }
 
 
+    /*!
+     * Calls f on each value of the subtree in the interval [left, right), 
+     * with left < right, relative to the subtree.
+     * @param node  the root of the subtree.
+     * @param left  the left boundary interval (includisve).
+     * @param right the right boundary of the interval (exclusive).
+     * @param f     the function.
+     */
+    template< typename F>
+    void for_each(node_t* node, K left, K right, F& f)
+    {
+        while(node != nullptr)
+        {
+            push(node);
+            const K node_rank = node->rank;
+            if(left < node_rank)
+                for_each(node->left, left, std::min(right, node_rank), f);
+            if(right <= node_rank)
+                return;
+            if(left <= node_rank)
+                f(static_cast<const_reference>(node->value));
+            // The right subtree is visited iteratively.
+            if(right == node_rank + 1)
+                return;
+            left = left > node_rank ? left - node_rank - 1 : 0;
+            right -= node_rank + 1;
+            node = node->right;
+        }
+    }
+
     /*!
      * Converts the tree into a sdt::vector of the values. 
      * @param node  the root of the subtree to append.
@@ -460,11 +2341,263 @@ public:
     {
         if(node == nullptr) return;
 
+        push(node);
         to_vector(node->left, vec);
         vec.push_back(node->value);
         to_vector(node->right,vec);
     }
 
+    /*!
+     * Writes the values of the subtree in the slice starting at out. The left
+     * subtree of large nodes is written by a new thread, while the right one
+     * is written by the current thread.
+     * @param node      the root of the subtree.
+     * @param out       the first position of the slice of the subtree.
+     * @param n_threads the maximum number of threads used.
+     */
+    void to_vector(node_t* node, S* out, size_t n_threads)
+    {
+        if(node == nullptr) return;
+
+        if(n_threads <= 1 or static_cast<size_t>(node->rank) < parallel_cutoff)
+        {
+            to_array(node, out);
+            return;
+        }
+        push(node);
+        out[node->rank] = node->value;
+        const size_t n_left = n_threads / 2;
+        std::thread worker(&avl_rmq::to_vector_slice, this, node->left, out, n_left);
+        to_vector(node->right, out + node->rank + 1, n_threads - n_left);
+        worker.join();
+    }
+
+    /*!
+     * Writes the values of the subtree in the slice starting at out.
+     */
+    void to_array(node_t* node, S* out)
+    {
+        if(node == nullptr) return;
+
+        push(node);
+        to_array(node->left, out);
+        out[node->rank] = node->value;
+        to_array(node->right, out + node->rank + 1);
+    }
+
+    /*!
+     * Entry point of the threads of to_vector, that is overloaded.
+     */
+    void to_vector_slice(node_t* node, S* out, size_t n_threads)
+    {
+        to_vector(node, out, n_threads);
+    }
+
+    /*!
+     * Writes the values of the subtree to the image.
+     * @param node    the root of the subtree.
+     * @param writer  the writer of the image.
+     */
+    void serialize(node_t* node, rmq_image_writer<K,S,Op>& writer)
+    {
+        if(node == nullptr) return;
+
+        push(node);
+        serialize(node->left, writer);
+        writer.push(node->value);
+        serialize(node->right, writer);
+    }
+
+    /*!
+     * Builds a perfectly balanced subtree from the next n elements of the
+     * range, constructing the nodes in the block in in-order.
+     * @param block the memory for the n nodes.
+     * @param n     the number of elements in the subtree.
+     * @param it    the iterator to the next element, advanced by n.
+     * @return      the root of the subtree.
+     */
+    template< typename It>
+    node_t* build(node_t* block, size_t n, It& it)
+    {
+        if(n == 0) return nullptr;
+
+        const size_t n_left = n / 2;
+        node_t* left = build(block, n_left, it);
+        const S value = static_cast<S>(*it);
+        node_t* node = new(block + n_left) node_t(static_cast<K>(n_left), value, Op::lift(value), 1, left);
+        ++it;
+        node->right = build(block + n_left + 1, n - n_left - 1, it);
+
+        node->depth = std::max(get_depth(node->left), get_depth(node->right)) + 1;
+        node->update_agg();
+        return node;
+    }
+
+    /*!
+     * Builds a perfectly balanced subtree from the n elements starting at
+     * first, as build, constructing the left subtree of large nodes in a new
+     * thread. The subtrees use disjoint parts of the block.
+     * @param block     the memory for the n nodes.
+     * @param n         the number of elements in the subtree.
+     * @param first     the random access iterator to the first element.
+     * @param n_threads the maximum number of threads used.
+     * @return          the root of the subtree.
+     */
+    template< typename It>
+    node_t* build(node_t* block, size_t n, It first, size_t n_threads)
+    {
+        if(n_threads <= 1 or n < 2 * parallel_cutoff)
+            return build(block, n, first);
+
+        const size_t n_left = n / 2;
+        const size_t t_left = n_threads / 2;
+        node_t* left = nullptr;
+        std::thread worker([this, block, n_left, first, t_left, &left]()
+        {
+            left = build(block, n_left, first, t_left);
+        });
+        const It mid = first + static_cast<std::ptrdiff_t>(n_left);
+        const S value = static_cast<S>(*mid);
+        node_t* node = new(block + n_left) node_t(static_cast<K>(n_left), value, Op::lift(value), 1);
+        node->right = build(block + n_left + 1, n - n_left - 1, mid + 1, n_threads - t_left);
+        worker.join();
+        node->left = left;
+
+        node->depth = std::max(get_depth(node->left), get_depth(node->right)) + 1;
+        node->update_agg();
+        return node;
+    }
+
+    /*!
+     * Check the invariants of the subtree rooted in node.
+     * @param node  the root of the subtree.
+     * @param size  set to the number of elements of the subtree.
+     * @return      true if all the invariants hold.
+     */
+    bool check_integrity(node_t* node, size_t& size)
+    {
+        size = 0;
+        if(node == nullptr)
+            return true;
+
+        push(node);
+        size_t left_size = 0;
+        size_t right_size = 0;
+        if(not check_integrity(node->left, left_size) or not check_integrity(node->right, right_size))
+            return false;
+        size = left_size + right_size + 1;
+
+        if(static_cast<size_t>(node->rank) != left_size)
+            return false;
+        const size_t left_depth = get_depth(node->left);
+        const size_t right_depth = get_depth(node->right);
+        if(static_cast<size_t>(node->depth) != std::max(left_depth, right_depth) + 1)
+            return false;
+        if(left_depth > right_depth + 1 or right_depth > left_depth + 1)
+            return false;
+
+        agg_t agg = Op::lift(node->value);
+        if(node->left != nullptr)
+            agg = Op::combine(node->left->agg, agg);
+        if(node->right != nullptr)
+            agg = Op::combine(agg, node->right->agg);
+        if(not (agg == node->agg))
+            return false;
+        return check_size(node, size, lazy_t());
+    }
+
+    inline bool check_size(const node_t*, size_t, std::false_type) { return true; }
+    inline bool check_size(const node_t* node, size_t size, std::true_type)
+    {
+        return static_cast<size_t>(node->size) == size;
+    }
+
+    /*!
+     * Appends the nodes of the first height levels of the subtree to order,
+     * in van Emde Boas order.
+     * @param node   the root of the subtree.
+     * @param height the number of levels of the subtree to be visited.
+     * @param order  the nodes in van Emde Boas order.
+     */
+    void veb_order(node_t* node, size_t height, std::vector<node_t*>& order)
+    {
+        if(node == nullptr or height == 0)
+            return;
+        if(height == 1)
+        {
+            order.push_back(node);
+            return;
+        }
+        const size_t top = height / 2;
+        veb_order(node, top, order);
+        veb_bottoms(node, top, height - top, order);
+    }
+
+    /*!
+     * Appends, from left to right, the van Emde Boas order of the subtrees 
+     * rooted at the given depth of the subtree.
+     * @param node   the root of the subtree.
+     * @param depth  the depth of the roots of the subtrees, relative to node.
+     * @param height the number of levels of the subtrees to be visited.
+     * @param order  the nodes in van Emde Boas order.
+     */
+    void veb_bottoms(node_t* node, size_t depth, size_t height, std::vector<node_t*>& order)
+    {
+        if(node == nullptr)
+            return;
+        if(depth == 0)
+            veb_order(node, height, order);
+        else
+        {
+            veb_bottoms(node->left, depth - 1, height, order);
+            veb_bottoms(node->right, depth - 1, height, order);
+        }
+    }
+
+    /*!
+     * Releases all the nodes of the tree.
+     */
+    void release()
+    {
+        if(pool != nullptr)
+        {
+            if(not pool.unique() or pool->is_forward())
+                destroy(root);
+            else
+            {
+                if(not std::is_trivially_destructible<node_t>::value)
+                    destroy(root);
+                pool->clear();
+            }
+        }
+        root = nullptr;
+        n_nodes = 0;
+        frozen.reset();
+    }
+
+    /*!
+     * Returns the pool of the tree, creating it if needed.
+     */
+    node_pool<node_t>& get_pool()
+    {
+        if(pool == nullptr)
+            pool = std::make_shared< node_pool<node_t> >();
+        return *pool;
+    }
+
+    /*!
+     * Destroys the nodes of the subtree. 
+     * @param node  the root of the subtree to be destroyed.
+     */
+    void destroy(node_t* node)
+    {
+        if(node == nullptr) return;
+
+        destroy(node->left);
+        destroy(node->right);
+        pool->destroy(node);
+    }
+
     /*!
      * Prints the values of the tree. 
      * @param node  the root of the subtree to be print.
@@ -473,6 +2606,7 @@ public:
     {
         if(node == nullptr) return;
 
+        push(node);
         print(node->left);
         std::cout << node->value << " ";
         print(node->right);
@@ -481,9 +2615,22 @@ public:
   private:
     node_t* root;
     K n_nodes;
+    std::shared_ptr< node_pool<node_t> > pool; // The memory of the nodes, shared by the trees obtained with split.
+    std::unique_ptr< static_rmq<K,S,Op> > frozen; // The static index built by freeze.
+    bool prefetch; // True if the descents of [] and () prefetch the children of the visited nodes.
+    Stats stats;   // The statistics of the operations, see rmq_stats.hpp.
 
 }; // avl_rmq
 
+template< typename K, typename S, typename Op, typename Stats>
+const size_t avl_rmq<K,S,Op,Stats>::max_height;
+
+template< typename K, typename S, typename Op, typename Stats>
+const size_t avl_rmq<K,S,Op,Stats>::batch_width;
+
+template< typename K, typename S, typename Op, typename Stats>
+const size_t avl_rmq<K,S,Op,Stats>::parallel_cutoff;
+
 
 
 #endif /* end of include guard: _AVL_RMQ_HH */
\ No newline at end of file
@@ -0,0 +1,491 @@
+////////////////////////////////////////////////////////////////////////////////
+// btree_rmq.hpp
+//   RMQ B-tree header file.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Massimiliano Rossi
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+/*!
+   \file btree_rmq.hpp
+   \brief btree_rmq.hpp Compute a dynamic RMQ with a B-tree
+   \author Massimiliano Rossi
+   \date 20/10/2021
+*/
+
+#ifndef _BTREE_RMQ_HH
+#define _BTREE_RMQ_HH
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <cstdint>
+#include <assert.h>
+#include "node_pool.hpp"
+
+/*!
+* Wide-node variant of avl_rmq.
+* Each internal node stores the sizes and the minimums of its up to B children
+* in contiguous arrays, and each leaf stores a block of up to B values. All the
+* leaves are at the same depth, so the depth of the tree is O(log_B n), and the
+* minimums inside a node are linear scans that the compiler can vectorize.
+* K is the type of the keys
+* S is the type of the values
+* B is the maximum number of children of a node and of values of a leaf
+*/
+template< typename K, typename S, size_t B = 64>
+class btree_rmq{
+public:
+
+    static_assert(B >= 4, "btree_rmq requires B >= 4");
+
+    typedef struct leaf_t{
+        S values[B];      // The values of the leaf.
+        uint32_t count;   // The number of values.
+
+        /*!
+        * Costructor
+        */
+        leaf_t():
+            values(),
+            count(0)
+        {
+
+        }
+
+    }leaf_t;
+
+    typedef struct inner_t{
+        K sizes[B];       // The number of values in the subtree of each child.
+        S mins[B];        // The minimum value in the subtree of each child.
+        void* children[B];// The children, leaves if the node is at level 1.
+        uint32_t count;   // The number of children.
+
+        /*!
+        * Costructor
+        */
+        inner_t():
+            sizes(),
+            mins(),
+            children(),
+            count(0)
+        {
+
+        }
+
+    }inner_t;
+
+    /*!
+    * Costructor
+    */
+    btree_rmq():
+        root(nullptr),
+        height(0),
+        n_values(0),
+        leaves(),
+        inners()
+    {
+
+    }
+
+    btree_rmq(const btree_rmq&) = delete;
+    btree_rmq& operator=(const btree_rmq&) = delete;
+
+    /*!
+    * Desctructor
+    * The nodes are released in bulk by the pools, the tree is visited only if
+    * the values need to be destroyed.
+    */
+    ~btree_rmq()
+    {
+        if(not std::is_trivially_destructible<S>::value)
+            destroy(root, height);
+    }
+
+    /*!
+     * @return the number of elements in the array.
+     */
+    inline size_t size() const
+    {
+        return n_values;
+    }
+
+    /*!
+     * Access the array.
+     * @param rank  the rank of the element to be accessed.
+     */
+    S operator[](K rank) const
+    {
+        if(rank >= n_values)
+            return S();
+
+        const void* node = root;
+        for(size_t level = height; level > 0; --level)
+        {
+            const inner_t* inner = static_cast<const inner_t*>(node);
+            const uint32_t i = find_child(inner, rank);
+            node = inner->children[i];
+        }
+        return static_cast<const leaf_t*>(node)->values[rank];
+    }
+
+    /*!
+     * Insert the value in the tree with rank rank. The elemnt with the same rank
+     * is moved on the right.
+     * @param rank  the rank of the element that has to be inserted.
+     * @param value the value information attached to the element.
+     */
+    void insert(K rank, S value)
+    {
+        if(rank > n_values)
+            rank = static_cast<K>(n_values);
+
+        if(root == nullptr)
+            root = leaves.create();
+
+        void* sibling = insert(root, height, rank, value);
+        if(sibling != nullptr)
+        {
+            // The root has been split, grow the tree.
+            inner_t* new_root = inners.create();
+            push_child(new_root, root, height);
+            push_child(new_root, sibling, height);
+            root = new_root;
+            height++;
+        }
+        n_values++;
+    }
+
+    /*!
+     * Update the value in the tree with rank rank.
+     * @param rank  the rank of the element that has to be inserted.
+     * @param value the value information attached to the element.
+     */
+    void update(K rank, S value)
+    {
+        if(rank >= n_values)
+            return;
+        update(root, height, rank, value);
+    }
+
+    /*!
+     * Computes the minimum in the interval [left, right).
+     * @param left  the left boundary interval (includisve).
+     * @param right the right boundary of the interval (exclusive).
+     */
+    S operator ()(K left, K right) const
+    {
+        if(right > n_values)
+            right = static_cast<K>(n_values);
+        if(left >= right)
+            return std::numeric_limits<S>::max();
+        return min_range(root, height, left, right);
+    }
+
+    /*!
+     * Returns the content of the array.
+     */
+    std::vector<S> to_vector() const
+    {
+        std::vector<S> res;
+        res.reserve(n_values);
+        to_vector(root, height, res);
+        return res;
+    }
+
+    /*!
+     * Print the tree.
+     */
+    void print() const
+    {
+        std::vector<S> vec = to_vector();
+        for(size_t i = 0; i < vec.size(); ++i)
+            std::cout << vec[i] << " ";
+        std::cout << std::endl;
+    }
+
+  protected:
+
+    /*!
+     * Computes the minimum of n contiguous values.
+     * @param values  the values.
+     * @param n       the number of values.
+     */
+    static inline S min_of(const S* values, size_t n)
+    {
+        S min = std::numeric_limits<S>::max();
+        for(size_t i = 0; i < n; ++i)
+            min = (values[i] < min ? values[i] : min);
+        return min;
+    }
+
+    /*!
+     * Finds the child of an internal node containing the element of key rank.
+     * @param node  the internal node.
+     * @param rank  the rank of the element, decreased to the rank in the child.
+     * @return      the index of the child.
+     */
+    static inline uint32_t find_child(const inner_t* node, K& rank)
+    {
+        uint32_t i = 0;
+        while(i + 1 < node->count and rank >= node->sizes[i])
+            rank -= node->sizes[i++];
+        return i;
+    }
+
+    /*!
+     * Computes the size and the minimum of a subtree.
+     * @param node  the root of the subtree.
+     * @param level the level of the node, 0 for leaves.
+     */
+    static void summary(const void* node, size_t level, K& size, S& min)
+    {
+        if(level == 0)
+        {
+            const leaf_t* leaf = static_cast<const leaf_t*>(node);
+            size = leaf->count;
+            min = min_of(leaf->values, leaf->count);
+            return;
+        }
+        const inner_t* inner = static_cast<const inner_t*>(node);
+        size = 0;
+        for(uint32_t i = 0; i < inner->count; ++i)
+            size += inner->sizes[i];
+        min = min_of(inner->mins, inner->count);
+    }
+
+    /*!
+     * Append a child to an internal node that is not full.
+     * @param node  the internal node.
+     * @param child the child.
+     * @param level the level of the child.
+     */
+    static void push_child(inner_t* node, void* child, size_t level)
+    {
+        assert(node->count < B);
+        const uint32_t i = node->count++;
+        node->children[i] = child;
+        summary(child, level, node->sizes[i], node->mins[i]);
+    }
+
+    /*!
+     * Insert the value in the subtree rooted in node with rank rank.
+     * @param node  the root of the subtree.
+     * @param level the level of the node, 0 for leaves.
+     * @param rank  the rank of the element that has to be inserted.
+     * @param value the value information attached to the element.
+     * @return      the new right sibling of node if node has been split,
+     *              nullptr otherwise.
+     */
+    void* insert(void* node, size_t level, K rank, const S& value)
+    {
+        if(level == 0)
+        {
+            leaf_t* leaf = static_cast<leaf_t*>(node);
+            leaf_t* sibling = nullptr;
+            if(leaf->count == B)
+            {
+                // Split the leaf in two halves.
+                sibling = leaves.create();
+                const uint32_t half = B / 2;
+                std::copy(leaf->values + half, leaf->values + B, sibling->values);
+                sibling->count = B - half;
+                leaf->count = half;
+                if(rank > half)
+                {
+                    rank -= half;
+                    leaf = sibling;
+                }
+            }
+            std::copy_backward(leaf->values + rank, leaf->values + leaf->count, leaf->values + leaf->count + 1);
+            leaf->values[rank] = value;
+            leaf->count++;
+            return sibling;
+        }
+
+        inner_t* inner = static_cast<inner_t*>(node);
+        // An element inserted at the end of a child stays in that child.
+        uint32_t i = 0;
+        while(i + 1 < inner->count and rank > inner->sizes[i])
+            rank -= inner->sizes[i++];
+
+        void* child_sibling = insert(inner->children[i], level - 1, rank, value);
+        if(child_sibling == nullptr)
+        {
+            inner->sizes[i]++;
+            inner->mins[i] = std::min(inner->mins[i], value);
+            return nullptr;
+        }
+
+        summary(inner->children[i], level - 1, inner->sizes[i], inner->mins[i]);
+
+        inner_t* sibling = nullptr;
+        if(inner->count == B)
+        {
+            // Split the node in two halves.
+            sibling = inners.create();
+            const uint32_t half = B / 2;
+            for(uint32_t j = half; j < B; ++j)
+            {
+                sibling->sizes[j - half] = inner->sizes[j];
+                sibling->mins[j - half] = inner->mins[j];
+                sibling->children[j - half] = inner->children[j];
+            }
+            sibling->count = B - half;
+            inner->count = half;
+            if(i >= half)
+            {
+                i -= half;
+                inner = sibling;
+            }
+        }
+
+        // Insert the new child after the i-th one.
+        for(uint32_t j = inner->count; j > i + 1; --j)
+        {
+            inner->sizes[j] = inner->sizes[j - 1];
+            inner->mins[j] = inner->mins[j - 1];
+            inner->children[j] = inner->children[j - 1];
+        }
+        inner->children[i + 1] = child_sibling;
+        summary(child_sibling, level - 1, inner->sizes[i + 1], inner->mins[i + 1]);
+        inner->count++;
+
+        return sibling;
+    }
+
+    /*!
+     * Update the element of key rank in the subtree rooted in node.
+     * @param node  the root of the subtree.
+     * @param level the level of the node, 0 for leaves.
+     * @param rank  the rank of the element we look for.
+     * @param value the new value of the element.
+     * @return      the new minimum of the subtree.
+     */
+    S update(void* node, size_t level, K rank, const S& value)
+    {
+        if(level == 0)
+        {
+            leaf_t* leaf = static_cast<leaf_t*>(node);
+            leaf->values[rank] = value;
+            return min_of(leaf->values, leaf->count);
+        }
+
+        inner_t* inner = static_cast<inner_t*>(node);
+        const uint32_t i = find_child(inner, rank);
+        inner->mins[i] = update(inner->children[i], level - 1, rank, value);
+        return min_of(inner->mins, inner->count);
+    }
+
+    /*!
+     * Computes the minimum in the interval [left, right) of the subtree rooted
+     * in node, with left < right.
+     * @param node  the root of the subtree.
+     * @param level the level of the node, 0 for leaves.
+     * @param left  the left boundary interval (includisve).
+     * @param right the right boundary of the interval (exclusive).
+     */
+    S min_range(const void* node, size_t level, K left, K right) const
+    {
+        if(level == 0)
+        {
+            const leaf_t* leaf = static_cast<const leaf_t*>(node);
+            return min_of(leaf->values + left, right - left);
+        }
+
+        const inner_t* inner = static_cast<const inner_t*>(node);
+        S min = std::numeric_limits<S>::max();
+        K offset = 0;
+        for(uint32_t i = 0; i < inner->count and offset < right; ++i)
+        {
+            const K end = offset + inner->sizes[i];
+            if(end > left)
+            {
+                // Use the minimum of the children covered by the interval.
+                if(left <= offset and end <= right)
+                    min = std::min(min, inner->mins[i]);
+                else
+                    min = std::min(min, min_range(inner->children[i], level - 1,
+                                                  (left > offset ? left - offset : 0),
+                                                  std::min(right, end) - offset));
+            }
+            offset = end;
+        }
+        return min;
+    }
+
+    /*!
+     * Appends the values of the subtree rooted in node to vec.
+     * @param node  the root of the subtree.
+     * @param level the level of the node, 0 for leaves.
+     * @param vec   the vector to append the array.
+     */
+    void to_vector(const void* node, size_t level, std::vector<S>& vec) const
+    {
+        if(node == nullptr) return;
+
+        if(level == 0)
+        {
+            const leaf_t* leaf = static_cast<const leaf_t*>(node);
+            vec.insert(vec.end(), leaf->values, leaf->values + leaf->count);
+            return;
+        }
+
+        const inner_t* inner = static_cast<const inner_t*>(node);
+        for(uint32_t i = 0; i < inner->count; ++i)
+            to_vector(inner->children[i], level - 1, vec);
+    }
+
+    /*!
+     * Destroys the nodes of the subtree.
+     * @param node  the root of the subtree.
+     * @param level the level of the node, 0 for leaves.
+     */
+    void destroy(void* node, size_t level)
+    {
+        if(node == nullptr) return;
+
+        if(level == 0)
+        {
+            leaves.destroy(static_cast<leaf_t*>(node));
+            return;
+        }
+
+        inner_t* inner = static_cast<inner_t*>(node);
+        for(uint32_t i = 0; i < inner->count; ++i)
+            destroy(inner->children[i], level - 1);
+        inners.destroy(inner);
+    }
+
+  private:
+    void* root;                 // The root, a leaf if height is 0.
+    size_t height;              // The number of levels of internal nodes.
+    size_t n_values;            // The number of elements in the array.
+    node_pool<leaf_t> leaves;   // The memory of the leaves.
+    node_pool<inner_t> inners;  // The memory of the internal nodes.
+
+}; // btree_rmq
+
+#endif /* end of include guard: _BTREE_RMQ_HH */
@@ -0,0 +1,744 @@
+////////////////////////////////////////////////////////////////////////////////
+// bucket_avl_rmq.hpp
+//   RMQ AVL storing a block of values in each node.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Massimiliano Rossi
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+/*!
+   \file bucket_avl_rmq.hpp
+   \brief bucket_avl_rmq.hpp Compute a dynamic RMQ with an AVL of blocks of values.
+   \author Massimiliano Rossi
+   \date 20/10/2021
+*/
+
+#ifndef _BUCKET_AVL_RMQ_HH
+#define _BUCKET_AVL_RMQ_HH
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <cstdint>
+#include <assert.h>
+#include "node_pool.hpp"
+
+/*!
+* Bucketed variant of avl_rmq.
+* Each node of the AVL stores a block of up to B consecutive values of the
+* array, the minimum of the block and the minimum of its subtree, so that the
+* metadata of a node is shared by B values. A full block is split in two
+* halves, and a block with less than B/4 values is merged with a neighbour if
+* they fit in a single block. The queries descend to the blocks containing the
+* boundaries of the interval, and scan the partial blocks with a loop that the
+* compiler can vectorize.
+* K is the type of the keys
+* S is the type of the values
+* B is the maximum number of values of a block
+*/
+template< typename K, typename S, size_t B = 64>
+class bucket_avl_rmq{
+public:
+
+    static_assert(B >= 4 and B <= 65535, "bucket_avl_rmq requires 4 <= B <= 65535");
+
+    typedef uint8_t d_t;
+
+    typedef struct node_t{
+        node_t *left;     // The pointer to the left child of the node.
+        node_t *right;    // The pointer to the right child of the node.
+        K rank;           // The number of values in the left subtree.
+        S min;            // The minimum value of the subtree.
+        S block_min;      // The minimum value of the block.
+        uint16_t count;   // The number of values of the block.
+        d_t depth;        // The depth of the node.
+        S values[B];      // The values of the block.
+
+        /*!
+        * Costructor
+        */
+        node_t():
+            left(nullptr),
+            right(nullptr),
+            rank(0),
+            min(std::numeric_limits<S>::max()),
+            block_min(std::numeric_limits<S>::max()),
+            count(0),
+            depth(1),
+            values()
+        {
+
+        }
+
+        /*!
+        * Recomputes the minimum of the block.
+        */
+        inline void update_block_min()
+        {
+            block_min = min_of(values, count);
+        }
+
+    }node_t;
+
+    /*!
+    * Costructor
+    */
+    bucket_avl_rmq():
+        root(nullptr),
+        n_values(0),
+        pool()
+    {
+
+    }
+
+    /*!
+    * Costructor
+    * Builds the tree from the range [first, last) in linear time, with the
+    * blocks full.
+    * @param first  the iterator to the first element.
+    * @param last   the iterator past the last element.
+    */
+    template< typename It>
+    bucket_avl_rmq(It first, It last):
+        bucket_avl_rmq()
+    {
+        n_values = static_cast<size_t>(std::distance(first, last));
+        const size_t n_blocks = (n_values + B - 1) / B;
+        root = build(0, n_blocks, n_blocks, first);
+    }
+
+    bucket_avl_rmq(const bucket_avl_rmq&) = delete;
+    bucket_avl_rmq& operator=(const bucket_avl_rmq&) = delete;
+
+    /*!
+    * Desctructor
+    * The nodes are released in bulk by the pool, the tree is visited only if
+    * the values need to be destroyed.
+    */
+    ~bucket_avl_rmq()
+    {
+        if(not std::is_trivially_destructible<S>::value)
+            destroy(root);
+    }
+
+    /*!
+     * @return the number of elements in the array.
+     */
+    inline size_t size() const
+    {
+        return n_values;
+    }
+
+    /*!
+     * @return the number of blocks.
+     */
+    inline size_t n_blocks() const
+    {
+        return pool.size();
+    }
+
+    /*!
+     * Access the array.
+     * @param rank  the rank of the element to be accessed.
+     */
+    S operator[](K rank) const
+    {
+        if(rank >= n_values)
+            return S();
+        const node_t* node = find(root, rank);
+        return node->values[rank];
+    }
+
+    /*!
+     * Insert the value in the tree with rank rank. The elemnt with the same rank
+     * is moved on the right.
+     * @param rank  the rank of the element that has to be inserted.
+     * @param value the value information attached to the element.
+     */
+    void insert(K rank, S value)
+    {
+        if(rank > n_values)
+            rank = static_cast<K>(n_values);
+        root = insert(root, rank, value);
+        n_values++;
+    }
+
+    /*!
+     * Update the value in the tree with rank rank.
+     * @param rank  the rank of the element that has to be updated.
+     * @param value the value information attached to the element.
+     */
+    void update(K rank, S value)
+    {
+        if(rank >= n_values)
+            return;
+        update(root, rank, value);
+    }
+
+    /*!
+     * Remove the element in the tree with rank rank. The elements on its right
+     * are moved on the left.
+     * @param rank  the rank of the element that has to be removed.
+     */
+    void erase(K rank)
+    {
+        if(rank >= n_values)
+            return;
+        K offset = rank;
+        const node_t* node = find(root, offset);
+        const K start = rank - offset;
+        const K count = node->count - 1;
+
+        root = erase(root, rank);
+        n_values--;
+
+        if(count == 0 or count >= B / 4)
+            return;
+        // Merge the block with its successor, or with its predecessor.
+        if(start + count < n_values)
+            merge(start, start + count);
+        else if(start > 0)
+        {
+            K prev = start - 1;
+            find(root, prev);
+            merge(start - 1 - prev, start);
+        }
+    }
+
+    /*!
+     * Computes the minimum in the interval [left, right).
+     * @param left  the left boundary interval (includisve).
+     * @param right the right boundary of the interval (exclusive).
+     */
+    S operator ()(K left, K right) const
+    {
+        if(right > n_values)
+            right = static_cast<K>(n_values);
+        if(left >= right)
+            return std::numeric_limits<S>::max();
+        if(left == 0 and right == n_values)
+            return root->min;
+        return min_range(root, left, right);
+    }
+
+    /*!
+     * Returns the content of the array.
+     */
+    std::vector<S> to_vector() const
+    {
+        std::vector<S> res;
+        res.reserve(n_values);
+        to_vector(root, res);
+        return res;
+    }
+
+    /*!
+     * Print the tree.
+     */
+    void print() const
+    {
+        std::vector<S> vec = to_vector();
+        for(size_t i = 0; i < vec.size(); ++i)
+            std::cout << vec[i] << " ";
+        std::cout << std::endl;
+    }
+
+  protected:
+
+    /*!
+     * Computes the minimum of n contiguous values.
+     * @param values  the values.
+     * @param n       the number of values.
+     */
+    static inline S min_of(const S* values, size_t n)
+    {
+        S min = std::numeric_limits<S>::max();
+        for(size_t i = 0; i < n; ++i)
+            min = (values[i] < min ? values[i] : min);
+        return min;
+    }
+
+    static inline S get_min(const node_t* node)
+    {
+        return node == nullptr ? std::numeric_limits<S>::max() : node->min;
+    }
+
+    static inline d_t get_depth(const node_t* node)
+    {
+        return node == nullptr ? 0 : node->depth;
+    }
+
+    /*!
+     * Recomputes the depth and the minimum of the subtree from the children.
+     */
+    static inline void update_node(node_t* node)
+    {
+        node->depth = std::max(get_depth(node->left), get_depth(node->right)) + 1;
+        node->min = std::min(node->block_min, std::min(get_min(node->left), get_min(node->right)));
+    }
+
+    /*!
+     * Finds the node whose block contains the element of key rank.
+     * @param rank  the rank of the element, set to its position in the block.
+     */
+    static const node_t* find(const node_t* node, K& rank)
+    {
+        while(true)
+        {
+            if(rank < node->rank)
+                node = node->left;
+            else if(rank < node->rank + node->count)
+            {
+                rank -= node->rank;
+                return node;
+            }
+            else
+            {
+                rank -= node->rank + node->count;
+                node = node->right;
+            }
+        }
+    }
+
+    /*!
+     * Right rotation of the subtree rooted in y.
+     * @return the new root of the subtree.
+     */
+    static node_t* rotate_right(node_t* y)
+    {
+        node_t* x = y->left;
+        y->left = x->right;
+        x->right = y;
+        y->rank -= x->rank + x->count;
+        update_node(y);
+        update_node(x);
+        return x;
+    }
+
+    /*!
+     * Left rotation of the subtree rooted in x.
+     * @return the new root of the subtree.
+     */
+    static node_t* rotate_left(node_t* x)
+    {
+        node_t* y = x->right;
+        x->right = y->left;
+        y->left = x;
+        y->rank += x->rank + x->count;
+        update_node(x);
+        update_node(y);
+        return y;
+    }
+
+    /*!
+     * Recomputes the node and restores the AVL property in it.
+     * @return the new root of the subtree.
+     */
+    static node_t* balance(node_t* node)
+    {
+        update_node(node);
+        const int diff = static_cast<int>(get_depth(node->left)) - static_cast<int>(get_depth(node->right));
+        if(diff > 1)
+        {
+            if(get_depth(node->left->left) < get_depth(node->left->right))
+                node->left = rotate_left(node->left);
+            return rotate_right(node);
+        }
+        if(diff < -1)
+        {
+            if(get_depth(node->right->right) < get_depth(node->right->left))
+                node->right = rotate_right(node->right);
+            return rotate_left(node);
+        }
+        return node;
+    }
+
+    /*!
+     * Insert the value in the subtree rooted in node with rank rank. A value
+     * inserted at the boundary between two blocks is appended to the end of
+     * the block on the left.
+     * @return the new root of the subtree.
+     */
+    node_t* insert(node_t* node, K rank, const S& value)
+    {
+        if(node == nullptr)
+        {
+            node = pool.create();
+            node->values[0] = value;
+            node->count = 1;
+            node->block_min = value;
+            node->min = value;
+            return node;
+        }
+
+        if(rank < node->rank)
+        {
+            node->rank++;
+            node->left = insert(node->left, rank, value);
+        }
+        else if(rank <= node->rank + node->count)
+        {
+            K pos = rank - node->rank;
+            node_t* block = node;
+            if(node->count == B)
+            {
+                // Split the block in two halves, the second one is the successor.
+                node_t* sibling = pool.create();
+                const uint16_t half = B / 2;
+                std::copy(node->values + half, node->values + B, sibling->values);
+                sibling->count = B - half;
+                node->count = half;
+                if(pos > half)
+                {
+                    pos -= half;
+                    block = sibling;
+                }
+                insert_value(block, pos, value);
+                node->update_block_min();
+                sibling->update_block_min();
+                sibling->min = sibling->block_min;
+                node->right = insert_leftmost(node->right, sibling);
+            }
+            else
+                insert_value(block, pos, value);
+        }
+        else
+            node->right = insert(node->right, rank - node->rank - node->count, value);
+
+        return balance(node);
+    }
+
+    /*!
+     * Insert the value in the block, that is not full.
+     */
+    static inline void insert_value(node_t* node, K pos, const S& value)
+    {
+        std::copy_backward(node->values + pos, node->values + node->count, node->values + node->count + 1);
+        node->values[pos] = value;
+        node->count++;
+        node->block_min = std::min(node->block_min, value);
+    }
+
+    /*!
+     * Insert the node as the first block of the subtree.
+     * @return the new root of the subtree.
+     */
+    static node_t* insert_leftmost(node_t* node, node_t* block)
+    {
+        if(node == nullptr)
+            return block;
+        node->rank += block->count;
+        node->left = insert_leftmost(node->left, block);
+        return balance(node);
+    }
+
+    /*!
+     * Update the element of key rank in the subtree rooted in node.
+     */
+    static void update(node_t* node, K rank, const S& value)
+    {
+        if(rank < node->rank)
+            update(node->left, rank, value);
+        else if(rank < node->rank + node->count)
+        {
+            S& old = node->values[rank - node->rank];
+            const bool rescan = (old == node->block_min and value > old);
+            old = value;
+            if(rescan)
+                node->update_block_min();
+            else
+                node->block_min = std::min(node->block_min, value);
+        }
+        else
+            update(node->right, rank - node->rank - node->count, value);
+        update_node(node);
+    }
+
+    /*!
+     * Remove the element of key rank in the subtree rooted in node, removing
+     * the block if it becomes empty.
+     * @return the new root of the subtree.
+     */
+    node_t* erase(node_t* node, K rank)
+    {
+        if(rank < node->rank)
+        {
+            node->rank--;
+            node->left = erase(node->left, rank);
+        }
+        else if(rank < node->rank + node->count)
+        {
+            const K pos = rank - node->rank;
+            const S old = node->values[pos];
+            std::copy(node->values + pos + 1, node->values + node->count, node->values + pos);
+            node->count--;
+            if(node->count == 0)
+                return remove_node(node);
+            if(old == node->block_min)
+                node->update_block_min();
+        }
+        else
+            node->right = erase(node->right, rank - node->rank - node->count);
+
+        return balance(node);
+    }
+
+    /*!
+     * Remove the node from the tree, replacing it with its successor, and
+     * release it.
+     * @return the new root of the subtree.
+     */
+    node_t* remove_node(node_t* node)
+    {
+        node_t* res;
+        if(node->left == nullptr)
+            res = node->right;
+        else if(node->right == nullptr)
+            res = node->left;
+        else
+        {
+            node_t* succ = nullptr;
+            node_t* right = detach_min(node->right, succ);
+            succ->left = node->left;
+            succ->right = right;
+            succ->rank = node->rank;
+            res = balance(succ);
+        }
+        pool.destroy(node);
+        return res;
+    }
+
+    /*!
+     * Detach the first block of the subtree.
+     * @param min set to the detached node.
+     * @return the new root of the subtree.
+     */
+    static node_t* detach_min(node_t* node, node_t*& min)
+    {
+        if(node->left == nullptr)
+        {
+            min = node;
+            return node->right;
+        }
+        node->left = detach_min(node->left, min);
+        node->rank -= min->count;
+        return balance(node);
+    }
+
+    /*!
+     * Remove the block starting at rank rank from the subtree, with count
+     * values.
+     * @return the new root of the subtree.
+     */
+    node_t* remove_block(node_t* node, K rank, K count)
+    {
+        if(rank < node->rank)
+        {
+            node->rank -= count;
+            node->left = remove_block(node->left, rank, count);
+        }
+        else if(rank == node->rank)
+            return remove_node(node);
+        else
+            node->right = remove_block(node->right, rank - node->rank - node->count, count);
+
+        return balance(node);
+    }
+
+    /*!
+     * Append the values at the end of the block starting at rank rank.
+     */
+    static void append(node_t* node, K rank, const S* values, K count)
+    {
+        if(rank < node->rank)
+        {
+            node->rank += count;
+            append(node->left, rank, values, count);
+        }
+        else if(rank == node->rank)
+        {
+            std::copy(values, values + count, node->values + node->count);
+            node->count += static_cast<uint16_t>(count);
+            node->block_min = std::min(node->block_min, min_of(values, count));
+        }
+        else
+            append(node->right, rank - node->rank - node->count, values, count);
+        update_node(node);
+    }
+
+    /*!
+     * Merge the two consecutive blocks starting at left and right, if their
+     * values fit in a single block.
+     */
+    void merge(K left, K right)
+    {
+        K l_offset = left;
+        K r_offset = right;
+        const node_t* l_node = find(root, l_offset);
+        const node_t* r_node = find(root, r_offset);
+        if(l_node->count + r_node->count > B)
+            return;
+        S values[B];
+        const K count = r_node->count;
+        std::copy(r_node->values, r_node->values + count, values);
+        root = remove_block(root, right, count);
+        append(root, left, values, count);
+    }
+
+    /*!
+     * Computes the minimum in the interval [left, right) of the subtree rooted
+     * in node, with left < right.
+     */
+    static S min_range(const node_t* node, K left, K right)
+    {
+        // Find the node where the paths to the boundaries split.
+        while(node != nullptr)
+        {
+            if(right <= node->rank)
+                node = node->left;
+            else if(left >= node->rank + node->count)
+            {
+                left -= node->rank + node->count;
+                right -= node->rank + node->count;
+                node = node->right;
+            }
+            else
+                break;
+        }
+
+        const K start = std::max(left, node->rank) - node->rank;
+        const K end = std::min<K>(right, node->rank + node->count) - node->rank;
+        S min = min_of(node->values + start, end - start);
+
+        // Suffix of the left subtree starting at left.
+        const node_t* curr = left < node->rank ? node->left : nullptr;
+        while(curr != nullptr)
+        {
+            if(left == 0)
+            {
+                min = std::min(min, curr->min);
+                break;
+            }
+            if(left <= curr->rank)
+            {
+                min = std::min(min, std::min(curr->block_min, get_min(curr->right)));
+                curr = curr->left;
+            }
+            else if(left < curr->rank + curr->count)
+            {
+                const K pos = left - curr->rank;
+                min = std::min(min, std::min(min_of(curr->values + pos, curr->count - pos), get_min(curr->right)));
+                break;
+            }
+            else
+            {
+                left -= curr->rank + curr->count;
+                curr = curr->right;
+            }
+        }
+
+        // Prefix of the right subtree ending at right.
+        K rest = right > node->rank + node->count ? right - node->rank - node->count : 0;
+        curr = rest > 0 ? node->right : nullptr;
+        while(curr != nullptr and rest > 0)
+        {
+            if(rest >= curr->rank + curr->count)
+            {
+                min = std::min(min, std::min(get_min(curr->left), curr->block_min));
+                rest -= curr->rank + curr->count;
+                curr = curr->right;
+            }
+            else if(rest > curr->rank)
+            {
+                min = std::min(min, std::min(get_min(curr->left), min_of(curr->values, rest - curr->rank)));
+                break;
+            }
+            else
+                curr = curr->left;
+        }
+        return min;
+    }
+
+    /*!
+     * Builds a perfectly balanced tree over the blocks [first, last) of the
+     * n_blocks blocks of the range, consuming their values from it.
+     */
+    template< typename It>
+    node_t* build(size_t first, size_t last, size_t n_blocks, It& it)
+    {
+        if(first >= last) return nullptr;
+
+        const size_t mid = first + (last - first) / 2;
+        node_t* left = build(first, mid, n_blocks, it);
+        node_t* node = pool.create();
+        node->left = left;
+        node->rank = static_cast<K>(block_start(mid, n_blocks) - block_start(first, n_blocks));
+        node->count = static_cast<uint16_t>(block_start(mid + 1, n_blocks) - block_start(mid, n_blocks));
+        for(uint16_t i = 0; i < node->count; ++i, ++it)
+            node->values[i] = *it;
+        node->update_block_min();
+        node->right = build(mid + 1, last, n_blocks, it);
+        update_node(node);
+        return node;
+    }
+
+    /*!
+     * @return the rank of the first value of the i-th block built.
+     */
+    inline size_t block_start(size_t i, size_t n_blocks) const
+    {
+        return n_values * i / n_blocks;
+    }
+
+    static void to_vector(const node_t* node, std::vector<S>& vec)
+    {
+        if(node == nullptr) return;
+
+        to_vector(node->left, vec);
+        vec.insert(vec.end(), node->values, node->values + node->count);
+        to_vector(node->right, vec);
+    }
+
+    /*!
+     * Releases the nodes of the subtree.
+     */
+    void destroy(node_t* node)
+    {
+        if(node == nullptr) return;
+
+        destroy(node->left);
+        destroy(node->right);
+        pool.destroy(node);
+    }
+
+  private:
+    node_t* root;
+    size_t n_values;
+    node_pool<node_t> pool; // The memory of the nodes.
+
+}; // bucket_avl_rmq
+
+#endif /* end of include guard: _BUCKET_AVL_RMQ_HH */
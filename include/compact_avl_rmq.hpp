@@ -0,0 +1,533 @@
+////////////////////////////////////////////////////////////////////////////////
+// compact_avl_rmq.hpp
+//   Compact RMQ AVL header file.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Massimiliano Rossi
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+/*!
+   \file compact_avl_rmq.hpp
+   \brief compact_avl_rmq.hpp Compute a dynamic RMQ with a compact node layout
+   \author Massimiliano Rossi
+   \date 20/10/2021
+*/
+
+#ifndef _COMPACT_AVL_RMQ_HH
+#define _COMPACT_AVL_RMQ_HH
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <assert.h>
+
+/*!
+* Compact variant of avl_rmq.
+* The nodes live in a std::vector and the children are 32-bit indices. The
+* most significant bit of each child index stores the balance factor of the
+* node (left heavy, right heavy or balanced), hence the tree can store up to
+* 2^31 - 2 elements. The index 0 is a sentinel node storing the neutral
+* minimum, so that empty subtrees need no special case.
+* K is the type of the keys
+* S is the type of the values
+*/
+template< typename K, typename S>
+class compact_avl_rmq{
+public:
+
+    typedef uint32_t index_t;
+
+    typedef struct node_t{
+        K rank;           // The number of nodes in the left subtree.
+        S value;          // The value of the node.
+        S min;            // The minimum value of the subtree.
+        index_t l;        // The index of the left child, the MSB is set if the node is left heavy.
+        index_t r;        // The index of the right child, the MSB is set if the node is right heavy.
+
+        /*!
+        * Costructor
+        */
+        node_t(K rank_, S value_, S min_, index_t l_ = 0, index_t r_ = 0):
+            rank(rank_),
+            value(value_),
+            min(min_),
+            l(l_),
+            r(r_)
+        {
+
+        }
+
+    }node_t;
+
+    /*!
+    * Costructor
+    */
+    compact_avl_rmq():
+        nodes(),
+        root(nil)
+    {
+        nodes.push_back(node_t(0, std::numeric_limits<S>::max(), std::numeric_limits<S>::max()));
+    }
+
+    /*!
+     * Reserve the memory for n elements.
+     * @param n  the number of elements.
+     */
+    void reserve(size_t n)
+    {
+        nodes.reserve(n + 1);
+    }
+
+    /*!
+     * @return the number of elements in the array.
+     */
+    inline size_t size() const
+    {
+        return nodes.size() - 1;
+    }
+
+    /*!
+     * Access the array.
+     * @param rank  the rank of the element to be accessed.
+     */
+    S operator[](K rank) const
+    {
+        if(rank >= size())
+            return S();
+        return nodes[search(rank)].value;
+    }
+
+    /*!
+     * Insert the value in the tree with rank rank. The elemnt with the same rank
+     * is moved on the right.
+     * @param rank  the rank of the element that has to be inserted.
+     * @param value the value information attached to the element.
+     */
+    void insert(K rank, S value)
+    {
+        assert(size() < index_mask);
+        // Allocate the node before descending, so that no reallocation
+        // happens during the insertion.
+        const index_t x = static_cast<index_t>(nodes.size());
+        nodes.push_back(node_t(0, value, value));
+        bool grown = false;
+        root = insert(root, rank, x, grown);
+    }
+
+    /*!
+     * Update the value in the tree with rank rank.
+     * @param rank  the rank of the element that has to be inserted.
+     * @param value the value information attached to the element.
+     */
+    void update(K rank, S value)
+    {
+        if(rank >= size())
+            return;
+
+        index_t path[max_height];
+        size_t length = 0;
+        index_t node = root;
+        while(true)
+        {
+            path[length++] = node;
+            const K node_rank = nodes[node].rank;
+            if (rank < node_rank)
+                node = left(node);
+            else if(rank > node_rank)
+            {
+                rank -= node_rank + 1;
+                node = right(node);
+            }
+            else
+                break;
+        }
+
+        nodes[node].value = value;
+        while(length > 0)
+            update_min(path[--length]);
+    }
+
+    /*!
+     * Computes the minimum in the interval [left, right).
+     * @param left  the left boundary interval (includisve).
+     * @param right the right boundary of the interval (exclusive).
+     */
+    S operator ()(K left, K right) const
+    {
+        if(right > size())
+            right = static_cast<K>(size());
+        if(left >= right)
+            return std::numeric_limits<S>::max();
+        return min_range(left, right);
+    }
+
+    /*!
+     * Returns the content of the array.
+     */
+    std::vector<S> to_vector() const
+    {
+        std::vector<S> res;
+        res.reserve(size());
+        to_vector(root, res);
+        return res;
+    }
+
+    /*!
+     * Print the tree.
+     */
+    void print() const
+    {
+        print(root);
+        std::cout << std::endl;
+    }
+
+  protected:
+
+    static const index_t nil = 0;
+    static const index_t heavy_bit = index_t(1) << 31;
+    static const index_t index_mask = heavy_bit - 1;
+    static const size_t max_height = 64;
+
+    inline index_t left(index_t node) const
+    {
+        return nodes[node].l & index_mask;
+    }
+
+    inline index_t right(index_t node) const
+    {
+        return nodes[node].r & index_mask;
+    }
+
+    inline void set_left(index_t node, index_t child)
+    {
+        nodes[node].l = (nodes[node].l & heavy_bit) | child;
+    }
+
+    inline void set_right(index_t node, index_t child)
+    {
+        nodes[node].r = (nodes[node].r & heavy_bit) | child;
+    }
+
+    /*!
+     * Return the balance factor of the node
+     * @return -1 if left heavy, 1 if right heavy, 0 otherwise
+     */
+    inline int get_balance(index_t node) const
+    {
+        if(nodes[node].l & heavy_bit)
+            return -1;
+        if(nodes[node].r & heavy_bit)
+            return 1;
+        return 0;
+    }
+
+    inline void set_balance(index_t node, int balance)
+    {
+        nodes[node].l = (nodes[node].l & index_mask) | (balance < 0 ? heavy_bit : 0);
+        nodes[node].r = (nodes[node].r & index_mask) | (balance > 0 ? heavy_bit : 0);
+    }
+
+    inline void update_min(index_t node)
+    {
+        node_t& x = nodes[node];
+        x.min = std::min(x.value, std::min(nodes[x.l & index_mask].min, nodes[x.r & index_mask].min));
+    }
+
+    /*!
+     * Rotate the subtree to the right. Balance factors are left to the caller.
+     * @return the new root.
+     */
+    index_t right_rotate(index_t y)
+    {
+        const index_t x = left(y);
+
+        set_left(y, right(x));
+        set_right(x, y);
+
+        nodes[y].rank -= nodes[x].rank + 1;
+
+        nodes[x].min = nodes[y].min;
+        update_min(y);
+
+        return x;
+    }
+
+    /*!
+     * Rotate the subtree to the left. Balance factors are left to the caller.
+     * @return the new root.
+     */
+    index_t left_rotate(index_t x)
+    {
+        const index_t y = right(x);
+
+        set_right(x, left(y));
+        set_left(y, x);
+
+        nodes[y].rank += nodes[x].rank + 1;
+
+        nodes[y].min = nodes[x].min;
+        update_min(x);
+
+        return y;
+    }
+
+    /*!
+     * Finds the element of key rank.
+     * @param  rank the rank of the element we look for.
+     * @return      the index of the element in the tree.
+     */
+    index_t search(K rank) const
+    {
+        index_t node = root;
+        while(node != nil)
+        {
+            const K node_rank = nodes[node].rank;
+            if (rank < node_rank)
+                node = left(node);
+            else if(rank > node_rank)
+            {
+                rank -= node_rank + 1;
+                node = right(node);
+            }
+            else
+                break;
+        }
+        return node;
+    }
+
+    /*!
+     * Insert the node x in the subtree rooted in node with rank rank.
+     * @param node  the root of the subtree.
+     * @param rank  the rank of the element that has to be inserted.
+     * @param x     the index of the node to be inserted.
+     * @param grown set to true if the height of the subtree increased.
+     * @return      the new root of the subtree.
+     */
+    index_t insert(index_t node, K rank, index_t x, bool& grown)
+    {
+        if (node == nil)
+        {
+            grown = true;
+            return x;
+        }
+
+        nodes[node].min = std::min(nodes[node].min, nodes[x].value);
+
+        if (rank <= nodes[node].rank)
+        {
+            nodes[node].rank++;
+            set_left(node, insert(left(node), rank, x, grown));
+            if(not grown)
+                return node;
+            const int balance = get_balance(node);
+            if(balance >= 0)
+            {
+                set_balance(node, balance - 1);
+                grown = (balance == 0);
+                return node;
+            }
+            grown = false;
+            return fix_left(node);
+        }
+        else
+        {
+            set_right(node, insert(right(node), rank - nodes[node].rank - 1, x, grown));
+            if(not grown)
+                return node;
+            const int balance = get_balance(node);
+            if(balance <= 0)
+            {
+                set_balance(node, balance + 1);
+                grown = (balance == 0);
+                return node;
+            }
+            grown = false;
+            return fix_right(node);
+        }
+    }
+
+    /*!
+     * Rebalance a node whose left subtree is two levels taller.
+     * @return the new root of the subtree.
+     */
+    index_t fix_left(index_t node)
+    {
+        const index_t child = left(node);
+        if(get_balance(child) < 0)
+        {
+            // Left Left Case
+            set_balance(node, 0);
+            set_balance(child, 0);
+            return right_rotate(node);
+        }
+        // Left Right Case
+        const index_t g = right(child);
+        const int g_balance = get_balance(g);
+        set_balance(child, g_balance > 0 ? -1 : 0);
+        set_balance(node, g_balance < 0 ? 1 : 0);
+        set_balance(g, 0);
+        set_left(node, left_rotate(child));
+        return right_rotate(node);
+    }
+
+    /*!
+     * Rebalance a node whose right subtree is two levels taller.
+     * @return the new root of the subtree.
+     */
+    index_t fix_right(index_t node)
+    {
+        const index_t child = right(node);
+        if(get_balance(child) > 0)
+        {
+            // Right Right Case
+            set_balance(node, 0);
+            set_balance(child, 0);
+            return left_rotate(node);
+        }
+        // Right Left Case
+        const index_t g = left(child);
+        const int g_balance = get_balance(g);
+        set_balance(child, g_balance < 0 ? 1 : 0);
+        set_balance(node, g_balance > 0 ? -1 : 0);
+        set_balance(g, 0);
+        set_right(node, right_rotate(child));
+        return left_rotate(node);
+    }
+
+    /*!
+     * Computes the minimum in the interval [left, right), with
+     * 0 <= left < right <= size().
+     * First finds the node splitting the interval, then walks down the left
+     * and the right boundary paths.
+     * @param left  the left boundary interval (includisve).
+     * @param right the right boundary of the interval (exclusive).
+     */
+    S min_range(K left_, K right_) const
+    {
+        index_t node = root;
+        while(true)
+        {
+            const K node_rank = nodes[node].rank;
+            if(right_ <= node_rank)
+                node = left(node);
+            else if(left_ > node_rank)
+            {
+                left_ -= node_rank + 1;
+                right_ -= node_rank + 1;
+                node = right(node);
+            }
+            else
+                break;
+        }
+
+        S min = nodes[node].value;
+
+        // Left boundary: the suffix of the left subtree starting at left_.
+        index_t curr = left(node);
+        while(curr != nil)
+        {
+            const K curr_rank = nodes[curr].rank;
+            if(left_ == 0)
+            {
+                min = std::min(min, nodes[curr].min);
+                break;
+            }
+            if(left_ <= curr_rank)
+            {
+                min = std::min(min, std::min(nodes[curr].value, nodes[right(curr)].min));
+                curr = left(curr);
+            }
+            else
+            {
+                left_ -= curr_rank + 1;
+                curr = right(curr);
+            }
+        }
+
+        // Right boundary: the prefix of the right subtree of length right_.
+        right_ -= nodes[node].rank + 1;
+        curr = right(node);
+        while(curr != nil and right_ > 0)
+        {
+            const K curr_rank = nodes[curr].rank;
+            if(right_ > curr_rank)
+            {
+                min = std::min(min, std::min(nodes[curr].value, nodes[left(curr)].min));
+                right_ -= curr_rank + 1;
+                curr = right(curr);
+            }
+            else
+                curr = left(curr);
+        }
+
+        return min;
+    }
+
+    /*!
+     * Converts the tree into a sdt::vector of the values.
+     * @param node  the root of the subtree to append.
+     * @param vec   the vector to append the array.
+     */
+    void to_vector(index_t node, std::vector<S>& vec) const
+    {
+        if(node == nil) return;
+
+        to_vector(left(node), vec);
+        vec.push_back(nodes[node].value);
+        to_vector(right(node), vec);
+    }
+
+    /*!
+     * Prints the values of the tree.
+     * @param node  the root of the subtree to be print.
+     */
+    void print(index_t node) const
+    {
+        if(node == nil) return;
+
+        print(left(node));
+        std::cout << nodes[node].value << " ";
+        print(right(node));
+    }
+
+  private:
+    std::vector<node_t> nodes;  // The nodes of the tree, nodes[0] is the sentinel.
+    index_t root;
+
+}; // compact_avl_rmq
+
+template< typename K, typename S>
+const typename compact_avl_rmq<K,S>::index_t compact_avl_rmq<K,S>::nil;
+
+template< typename K, typename S>
+const typename compact_avl_rmq<K,S>::index_t compact_avl_rmq<K,S>::heavy_bit;
+
+template< typename K, typename S>
+const typename compact_avl_rmq<K,S>::index_t compact_avl_rmq<K,S>::index_mask;
+
+template< typename K, typename S>
+const size_t compact_avl_rmq<K,S>::max_height;
+
+#endif /* end of include guard: _COMPACT_AVL_RMQ_HH */
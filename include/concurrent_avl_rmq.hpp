@@ -0,0 +1,704 @@
+////////////////////////////////////////////////////////////////////////////////
+// concurrent_avl_rmq.hpp
+//   RMQ AVL with lock-free readers and a single writer.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Massimiliano Rossi
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+/*!
+   \file concurrent_avl_rmq.hpp
+   \brief concurrent_avl_rmq.hpp Compute a dynamic RMQ with lock-free readers.
+   \author Massimiliano Rossi
+   \date 20/10/2021
+*/
+
+#ifndef _CONCURRENT_AVL_RMQ_HH
+#define _CONCURRENT_AVL_RMQ_HH
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <limits>
+#include <utility>
+#include <type_traits>
+#include <assert.h>
+#include "node_pool.hpp"
+#include "rmq_ops.hpp"
+
+/*!
+* Dynamic array supporting Range Minimum Queries, for many reader threads and
+* a single writer thread.
+* The writer never modifies the nodes reachable by the readers: insert, update
+* and erase copy the nodes on the path to the modified element, and publish the
+* new root atomically. The readers take a snapshot of the current root and
+* query it without locks. The nodes replaced by the writer are reclaimed with
+* epoch-based reclamation, once no snapshot can reach them.
+* K is the type of the keys
+* S is the type of the values
+* Op is the aggregate maintained for each subtree, see rmq_ops.hpp
+*/
+template< typename K, typename S, typename Op = rmq_min<S> >
+class concurrent_avl_rmq{
+public:
+
+    typedef typename Op::value_type agg_t;
+    typedef uint8_t d_t;
+
+    typedef struct node_t{
+        K rank;           // The size of the left subtree.
+        S value;          // The value of the node.
+        agg_t agg;        // The aggregate of the values of the subtree.
+        d_t depth;        // The depth of the node.
+        uint64_t stamp;   // The write that created the node.
+        node_t *left;     // The pointer to the left child of the node.
+        node_t *right;    // The pointer to the right child of the node.
+
+        /*!
+        * Costructor
+        */
+        node_t(K rank_, S value_, uint64_t stamp_):
+            rank(rank_),
+            value(value_),
+            agg(Op::lift(value)),
+            depth(1),
+            stamp(stamp_),
+            left(nullptr),
+            right(nullptr)
+        {
+
+        }
+
+        /*!
+        * Recompute the aggregate of the subtree from the ones of the children.
+        */
+        inline void update_agg()
+        {
+            agg = Op::lift(value);
+            if(left != nullptr)
+                agg = Op::combine(left->agg, agg);
+            if(right != nullptr)
+                agg = Op::combine(agg, right->agg);
+        }
+
+    }node_t;
+
+    /*!
+    * Consistent view of the array, that can be queried without locks. The
+    * nodes reachable by a snapshot are not reclaimed until it is destroyed.
+    */
+    class snapshot_t{
+    public:
+
+        snapshot_t(const snapshot_t&) = delete;
+        snapshot_t& operator=(const snapshot_t&) = delete;
+
+        /*!
+        * Move costructor
+        */
+        snapshot_t(snapshot_t&& other):
+            tree(other.tree),
+            slot(other.slot),
+            root(other.root),
+            n(other.n)
+        {
+            other.tree = nullptr;
+        }
+
+        /*!
+        * Desctructor
+        */
+        ~snapshot_t()
+        {
+            if(tree != nullptr)
+                tree->unpin(slot);
+        }
+
+        /*!
+         * @return the number of elements of the array.
+         */
+        inline K size() const
+        {
+            return n;
+        }
+
+        /*!
+         * Access the array.
+         * @param rank  the rank of the element to be accessed.
+         */
+        S operator[](K rank) const
+        {
+            if(rank >= n)
+                return 0;
+            return concurrent_avl_rmq::search(root, rank)->value;
+        }
+
+        /*!
+         * Computes the aggregate of the interval [left, right), by default its
+         * minimum.
+         * @param left  the left boundary interval (includisve).
+         * @param right the right boundary of the interval (exclusive).
+         */
+        agg_t operator()(K left, K right) const
+        {
+            if(right > n)
+                right = n;
+            if(left >= right)
+                return Op::identity();
+            return concurrent_avl_rmq::min_range(root, left, right);
+        }
+
+        /*!
+         * @return the array as an std::vector.
+         */
+        std::vector<S> to_vector() const
+        {
+            std::vector<S> res;
+            res.reserve(n);
+            concurrent_avl_rmq::to_vector(root, res);
+            return res;
+        }
+
+      private:
+        friend class concurrent_avl_rmq;
+
+        snapshot_t(concurrent_avl_rmq* tree_, size_t slot_, const node_t* root_):
+            tree(tree_),
+            slot(slot_),
+            root(root_),
+            n(concurrent_avl_rmq::size(root_))
+        {
+
+        }
+
+        concurrent_avl_rmq* tree;   // The tree, null if moved.
+        size_t slot;                // The epoch slot pinned by the snapshot.
+        const node_t* root;         // The root of the snapshot.
+        K n;                        // The number of elements.
+    };
+
+    /*!
+    * Costructor
+    * @param max_readers the number of snapshots that can be alive at the same
+    *                    time. Further snapshots wait for a free slot.
+    */
+    concurrent_avl_rmq(size_t max_readers = 64):
+        root(nullptr),
+        n_nodes(0),
+        stamp(0),
+        epoch(1),
+        slots(new slot_t[max_readers]),
+        n_slots(max_readers),
+        pool(),
+        retired()
+    {
+        for(size_t i = 0; i < n_slots; ++i)
+            slots[i].epoch.store(free_slot, std::memory_order_relaxed);
+    }
+
+    concurrent_avl_rmq(const concurrent_avl_rmq&) = delete;
+    concurrent_avl_rmq& operator=(const concurrent_avl_rmq&) = delete;
+
+    /*!
+    * Desctructor
+    * There must be no alive snapshots.
+    */
+    ~concurrent_avl_rmq()
+    {
+        if(not std::is_trivially_destructible<node_t>::value)
+        {
+            destroy(root.load(std::memory_order_relaxed));
+            for(size_t i = 0; i < retired.size(); ++i)
+                pool.destroy(retired[i].second);
+        }
+    }
+
+    /*!
+     * Take a snapshot of the current array. Thread safe.
+     */
+    snapshot_t snapshot()
+    {
+        const size_t slot = pin();
+        return snapshot_t(this, slot, root.load(std::memory_order_seq_cst));
+    }
+
+    /*!
+     * Access the current array, through a temporary snapshot. Thread safe.
+     * @param rank  the rank of the element to be accessed.
+     */
+    S operator[](K rank)
+    {
+        return snapshot()[rank];
+    }
+
+    /*!
+     * Computes the aggregate of the interval [left, right) of the current
+     * array, through a temporary snapshot. Thread safe.
+     * @param left  the left boundary interval (includisve).
+     * @param right the right boundary of the interval (exclusive).
+     */
+    agg_t operator()(K left, K right)
+    {
+        return snapshot()(left, right);
+    }
+
+    /*!
+     * @return the number of elements of the array. Only for the writer.
+     */
+    inline K size() const
+    {
+        return n_nodes;
+    }
+
+    /*!
+     * Insert the value before the element with rank rank. Only for the writer.
+     * @param rank  the rank of the element that has to be inserted.
+     * @param value the value information attached to the element.
+     */
+    void insert(K rank, S value)
+    {
+        if(rank > n_nodes)
+            rank = n_nodes;
+        ++stamp;
+        publish(insert(root.load(std::memory_order_relaxed), rank, value));
+        n_nodes++;
+    }
+
+    /*!
+     * Update the value with rank rank. Only for the writer.
+     * @param rank  the rank of the element that has to be updated.
+     * @param value the value information attached to the element.
+     */
+    void update(K rank, S value)
+    {
+        if(rank >= n_nodes)
+            return;
+        ++stamp;
+        publish(update(root.load(std::memory_order_relaxed), rank, value));
+    }
+
+    /*!
+     * Remove the element with rank rank. Only for the writer.
+     * @param rank  the rank of the element that has to be removed.
+     */
+    void erase(K rank)
+    {
+        if(rank >= n_nodes)
+            return;
+        ++stamp;
+        publish(erase(root.load(std::memory_order_relaxed), rank));
+        n_nodes--;
+    }
+
+    /*!
+     * Reclaim the replaced nodes that are not reachable by any snapshot. It is
+     * called by every write. Only for the writer.
+     */
+    void reclaim()
+    {
+        uint64_t min_epoch = free_slot;
+        for(size_t i = 0; i < n_slots; ++i)
+            min_epoch = std::min(min_epoch, slots[i].epoch.load(std::memory_order_seq_cst));
+
+        // The retired nodes are sorted by epoch.
+        size_t i = 0;
+        for(; i < retired.size() and retired[i].first < min_epoch; ++i)
+            pool.destroy(retired[i].second);
+        retired.erase(retired.begin(), retired.begin() + static_cast<std::ptrdiff_t>(i));
+    }
+
+    /*!
+     * @return the number of replaced nodes not yet reclaimed.
+     */
+    inline size_t pending() const
+    {
+        return retired.size();
+    }
+
+    /*!
+     * Print the current array.
+     */
+    void print()
+    {
+        std::vector<S> vec = snapshot().to_vector();
+        for(size_t i = 0; i < vec.size(); ++i)
+            std::cout << vec[i] << " ";
+        std::cout << std::endl;
+    }
+
+  protected:
+
+    static const uint64_t free_slot = std::numeric_limits<uint64_t>::max();
+
+    /*!
+     * The epoch pinned by a snapshot, padded to its own cache line.
+     */
+    typedef struct slot_t{
+        std::atomic<uint64_t> epoch;
+        char padding[64 - sizeof(std::atomic<uint64_t>)];
+    }slot_t;
+
+    /*!
+     * Pin the current epoch in a free slot, waiting if there is none.
+     * @return the index of the slot.
+     */
+    size_t pin()
+    {
+        while(true)
+        {
+            for(size_t i = 0; i < n_slots; ++i)
+            {
+                uint64_t expected = free_slot;
+                if(slots[i].epoch.load(std::memory_order_relaxed) == free_slot and
+                   slots[i].epoch.compare_exchange_strong(expected, epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst))
+                    return i;
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    /*!
+     * Release the slot of a snapshot.
+     */
+    inline void unpin(size_t slot)
+    {
+        slots[slot].epoch.store(free_slot, std::memory_order_release);
+    }
+
+    /*!
+     * Publish the new root and advance the epoch. The nodes retired in the
+     * previous epochs are reclaimed if no snapshot pinned them. A snapshot
+     * pinning an epoch larger than the one of a retired node loaded the root
+     * after the node was replaced.
+     */
+    void publish(node_t* new_root)
+    {
+        root.store(new_root, std::memory_order_seq_cst);
+        epoch.fetch_add(1, std::memory_order_seq_cst);
+        reclaim();
+    }
+
+    /*!
+     * Return a node that can be modified by the current write: the node itself
+     * if it was created by the write, otherwise a copy, and the node is retired.
+     */
+    node_t* own(node_t* node)
+    {
+        if(node->stamp == stamp)
+            return node;
+        node_t* copy = pool.create(*node);
+        copy->stamp = stamp;
+        retired.push_back(std::make_pair(epoch.load(std::memory_order_relaxed), node));
+        return copy;
+    }
+
+    static inline d_t get_depth(const node_t* node)
+    {
+        return node == nullptr ? 0 : node->depth;
+    }
+
+    static inline agg_t get_agg(const node_t* node)
+    {
+        return node == nullptr ? Op::identity() : node->agg;
+    }
+
+    /*!
+     * Rotate the subtree to the right. The root must be owned by the write.
+     * @return the new root.
+     */
+    node_t* right_rotate(node_t* y)
+    {
+        node_t* x = own(y->left);
+        y->left = x->right;
+        x->right = y;
+        y->rank -= x->rank + 1;
+        x->agg = y->agg;
+        y->update_agg();
+        y->depth = std::max(get_depth(y->left), get_depth(y->right)) + 1;
+        x->depth = std::max(get_depth(x->left), get_depth(x->right)) + 1;
+        return x;
+    }
+
+    /*!
+     * Rotate the subtree to the left. The root must be owned by the write.
+     * @return the new root.
+     */
+    node_t* left_rotate(node_t* x)
+    {
+        node_t* y = own(x->right);
+        x->right = y->left;
+        y->left = x;
+        y->rank += x->rank + 1;
+        y->agg = x->agg;
+        x->update_agg();
+        x->depth = std::max(get_depth(x->left), get_depth(x->right)) + 1;
+        y->depth = std::max(get_depth(y->left), get_depth(y->right)) + 1;
+        return y;
+    }
+
+    /*!
+     * Update the depth of the node and rotate the subtree if unbalanced. The
+     * node must be owned by the write.
+     * @return the new root of the subtree.
+     */
+    node_t* rebalance(node_t* node)
+    {
+        const d_t l_depth = get_depth(node->left);
+        const d_t r_depth = get_depth(node->right);
+        node->depth = std::max(l_depth, r_depth) + 1;
+        if(l_depth > r_depth + 1)
+        {
+            if(get_depth(node->left->left) < get_depth(node->left->right))
+                node->left = left_rotate(own(node->left));
+            return right_rotate(node);
+        }
+        if(r_depth > l_depth + 1)
+        {
+            if(get_depth(node->right->right) < get_depth(node->right->left))
+                node->right = right_rotate(own(node->right));
+            return left_rotate(node);
+        }
+        return node;
+    }
+
+    /*!
+     * Insert the value in the subtree, copying the path.
+     * @return the new root of the subtree.
+     */
+    node_t* insert(node_t* node, K rank, const S& value)
+    {
+        if(node == nullptr)
+            return pool.create(K(0), value, stamp);
+        node = own(node);
+        if(rank <= node->rank)
+        {
+            node->left = insert(node->left, rank, value);
+            node->rank++;
+        }
+        else
+            node->right = insert(node->right, rank - node->rank - 1, value);
+        node->update_agg();
+        return rebalance(node);
+    }
+
+    /*!
+     * Update the value in the subtree, copying the path.
+     * @return the new root of the subtree.
+     */
+    node_t* update(node_t* node, K rank, const S& value)
+    {
+        node = own(node);
+        if(rank < node->rank)
+            node->left = update(node->left, rank, value);
+        else if(rank > node->rank)
+            node->right = update(node->right, rank - node->rank - 1, value);
+        else
+            node->value = value;
+        node->update_agg();
+        return node;
+    }
+
+    /*!
+     * Remove the element from the subtree, copying the path.
+     * @return the new root of the subtree.
+     */
+    node_t* erase(node_t* node, K rank)
+    {
+        node = own(node);
+        if(rank < node->rank)
+        {
+            node->left = erase(node->left, rank);
+            node->rank--;
+        }
+        else if(rank > node->rank)
+            node->right = erase(node->right, rank - node->rank - 1);
+        else
+        {
+            node_t* left = node->left;
+            node_t* right = node->right;
+            retire(node);
+            if(left == nullptr or right == nullptr)
+                return (left != nullptr ? left : right);
+            // Replace the node with its successor.
+            right = erase_min(right, node);
+            node->left = left;
+            node->right = right;
+            node->rank = rank;
+        }
+        node->update_agg();
+        return rebalance(node);
+    }
+
+    /*!
+     * Detach the first element of the subtree, copying the path.
+     * @param min   set to the detached node, owned by the write.
+     * @return      the new root of the subtree.
+     */
+    node_t* erase_min(node_t* node, node_t*& min)
+    {
+        node = own(node);
+        if(node->left == nullptr)
+        {
+            min = node;
+            return node->right;
+        }
+        node->left = erase_min(node->left, min);
+        node->rank--;
+        node->update_agg();
+        return rebalance(node);
+    }
+
+    /*!
+     * Retire a node removed by the current write. Nodes created by the write
+     * are not visible to the readers and are released immediately.
+     */
+    void retire(node_t* node)
+    {
+        if(node->stamp == stamp)
+            pool.destroy(node);
+        else
+            retired.push_back(std::make_pair(epoch.load(std::memory_order_relaxed), node));
+    }
+
+    static K size(const node_t* node)
+    {
+        K n = 0;
+        for(; node != nullptr; node = node->right)
+            n += node->rank + 1;
+        return n;
+    }
+
+    static const node_t* search(const node_t* node, K rank)
+    {
+        while(node != nullptr)
+        {
+            if(rank < node->rank)
+                node = node->left;
+            else if(rank > node->rank)
+            {
+                rank -= node->rank + 1;
+                node = node->right;
+            }
+            else
+                break;
+        }
+        return node;
+    }
+
+    /*!
+     * Computes the aggregate of the interval [left, right), with left < right,
+     * as avl_rmq::min_range.
+     */
+    static agg_t min_range(const node_t* node, K left, K right)
+    {
+        while(node != nullptr)
+        {
+            if(node->rank >= right)
+                node = node->left;
+            else if(node->rank < left)
+            {
+                left -= node->rank + 1;
+                right -= node->rank + 1;
+                node = node->right;
+            }
+            else
+                break;
+        }
+        if(node == nullptr)
+            return Op::identity();
+
+        agg_t agg = Op::lift(node->value);
+
+        const node_t* curr = node->left;
+        while(curr != nullptr)
+        {
+            if(left == 0)
+            {
+                agg = Op::combine(curr->agg, agg);
+                break;
+            }
+            if(left <= curr->rank)
+            {
+                agg = Op::combine(Op::lift(curr->value), Op::combine(get_agg(curr->right), agg));
+                curr = curr->left;
+            }
+            else
+            {
+                left -= curr->rank + 1;
+                curr = curr->right;
+            }
+        }
+
+        right -= node->rank + 1;
+        curr = node->right;
+        while(curr != nullptr and right > 0)
+        {
+            if(right > curr->rank)
+            {
+                agg = Op::combine(Op::combine(agg, get_agg(curr->left)), Op::lift(curr->value));
+                right -= curr->rank + 1;
+                curr = curr->right;
+            }
+            else
+                curr = curr->left;
+        }
+        return agg;
+    }
+
+    static void to_vector(const node_t* node, std::vector<S>& vec)
+    {
+        if(node == nullptr) return;
+
+        to_vector(node->left, vec);
+        vec.push_back(node->value);
+        to_vector(node->right, vec);
+    }
+
+    void destroy(node_t* node)
+    {
+        if(node == nullptr) return;
+
+        destroy(node->left);
+        destroy(node->right);
+        pool.destroy(node);
+    }
+
+  private:
+    std::atomic<node_t*> root;  // The last published root.
+    K n_nodes;                  // The number of elements, for the writer.
+    uint64_t stamp;             // The number of writes.
+    std::atomic<uint64_t> epoch; // The current epoch.
+    std::unique_ptr<slot_t[]> slots; // The epochs pinned by the snapshots.
+    size_t n_slots;             // The number of slots.
+    node_pool<node_t> pool;     // The memory of the nodes, used only by the writer.
+    std::vector< std::pair<uint64_t, node_t*> > retired; // The replaced nodes and the epoch of their replacement.
+
+}; // concurrent_avl_rmq
+
+template< typename K, typename S, typename Op>
+const uint64_t concurrent_avl_rmq<K,S,Op>::free_slot;
+
+#endif /* end of include guard: _CONCURRENT_AVL_RMQ_HH */
@@ -0,0 +1,234 @@
+////////////////////////////////////////////////////////////////////////////////
+// mapped_rmq.hpp
+//   Read-only rmq over a memory mapped image.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Massimiliano Rossi
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+/*!
+   \file mapped_rmq.hpp
+   \brief mapped_rmq.hpp Read-only rmq over a memory mapped image.
+   \author Massimiliano Rossi
+   \date 20/10/2021
+*/
+
+#ifndef _MAPPED_RMQ_HH
+#define _MAPPED_RMQ_HH
+
+#include <cstdint>
+#include <cstddef>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "rmq_ops.hpp"
+#include "rmq_image.hpp"
+
+/*!
+* Read-only array supporting Range Minimum Queries, answered in place on a
+* memory mapped image written by avl_rmq::serialize. Opening the image costs
+* O(1) time, and the pages are loaded by the operating system on demand.
+* A query scans the values of the two boundary blocks and combines O(log n)
+* aggregates of the block tree.
+* K is the type of the keys
+* S is the type of the values
+* Op is the aggregate of the image, see rmq_ops.hpp
+*/
+template< typename K, typename S, typename Op = rmq_min<S> >
+class mapped_rmq{
+public:
+    typedef typename Op::value_type agg_t;
+
+    /*!
+    * Costructor
+    */
+    mapped_rmq():
+        data(nullptr),
+        n_bytes(0),
+        header(nullptr),
+        values(nullptr),
+        tree(nullptr)
+    {
+
+    }
+
+    /*!
+    * Costructor
+    * Maps the image stored in the file.
+    * @param path  the path of the file.
+    */
+    mapped_rmq(const char* path):
+        mapped_rmq()
+    {
+        open(path);
+    }
+
+    mapped_rmq(const mapped_rmq&) = delete;
+    mapped_rmq& operator=(const mapped_rmq&) = delete;
+
+    /*!
+    * Desctructor
+    */
+    ~mapped_rmq()
+    {
+        close();
+    }
+
+    /*!
+     * Map the image stored in the file.
+     * @param path  the path of the file.
+     * @return      false if the file can not be mapped or is not a valid
+     *              image with the types and the aggregate of the class, see
+     *              rmq_image_header::check.
+     */
+    bool open(const char* path)
+    {
+        close();
+        const int fd = ::open(path, O_RDONLY);
+        if(fd < 0)
+            return false;
+        struct stat st;
+        if(fstat(fd, &st) != 0 or static_cast<uint64_t>(st.st_size) < sizeof(rmq_image_header))
+        {
+            ::close(fd);
+            return false;
+        }
+        n_bytes = static_cast<size_t>(st.st_size);
+        void* ptr = mmap(nullptr, n_bytes, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if(ptr == MAP_FAILED)
+        {
+            n_bytes = 0;
+            return false;
+        }
+        data = static_cast<const char*>(ptr);
+        header = reinterpret_cast<const rmq_image_header*>(data);
+        if(not header->check<K,S,Op>() or header->size() > n_bytes)
+        {
+            close();
+            return false;
+        }
+        values = reinterpret_cast<const S*>(data + header->values_offset);
+        tree = reinterpret_cast<const agg_t*>(data + header->tree_offset);
+        return true;
+    }
+
+    /*!
+     * Unmap the image.
+     */
+    void close()
+    {
+        if(data != nullptr)
+            munmap(const_cast<char*>(data), n_bytes);
+        data = nullptr;
+        n_bytes = 0;
+        header = nullptr;
+        values = nullptr;
+        tree = nullptr;
+    }
+
+    /*!
+     * @return true if an image is mapped.
+     */
+    inline bool is_open() const
+    {
+        return data != nullptr;
+    }
+
+    /*!
+     * @return the number of elements of the array.
+     */
+    inline K size() const
+    {
+        return header != nullptr ? static_cast<K>(header->n) : 0;
+    }
+
+    /*!
+     * Access the array.
+     * @param rank  the rank of the element to be accessed.
+     */
+    S operator[](K rank) const
+    {
+        if(rank >= size())
+            return 0;
+        return values[rank];
+    }
+
+    /*!
+     * Computes the aggregate of the interval [left, right), by default its
+     * minimum.
+     * @param left  the left boundary interval (includisve).
+     * @param right the right boundary of the interval (exclusive).
+     */
+    agg_t operator()(K left, K right) const
+    {
+        if(right > size())
+            right = size();
+        if(left >= right)
+            return Op::identity();
+
+        const uint64_t block = header->block;
+        uint64_t l_block = left / block;
+        const uint64_t r_block = (right - 1) / block;
+        if(l_block == r_block)
+            return scan(left, right);
+
+        // Left boundary block, middle blocks and right boundary block.
+        agg_t l_agg = scan(left, static_cast<K>((l_block + 1) * block));
+        agg_t r_agg = scan(static_cast<K>(r_block * block), right);
+        uint64_t l = header->leaves + l_block + 1;
+        uint64_t r = header->leaves + r_block;
+        for(; l < r; l /= 2, r /= 2)
+        {
+            if(l & 1)
+                l_agg = Op::combine(l_agg, tree[l++]);
+            if(r & 1)
+                r_agg = Op::combine(tree[--r], r_agg);
+        }
+        return Op::combine(l_agg, r_agg);
+    }
+
+  protected:
+
+    /*!
+     * Computes the aggregate of the values in [left, right).
+     */
+    inline agg_t scan(K left, K right) const
+    {
+        agg_t agg = Op::identity();
+        for(K i = left; i < right; ++i)
+            agg = Op::combine(agg, Op::lift(values[i]));
+        return agg;
+    }
+
+  private:
+    const char* data;                   // The mapped memory.
+    size_t n_bytes;                     // The size of the mapped memory.
+    const rmq_image_header* header;     // The header of the image.
+    const S* values;                    // The values of the array.
+    const agg_t* tree;                  // The block tree.
+
+}; // mapped_rmq
+
+#endif /* end of include guard: _MAPPED_RMQ_HH */
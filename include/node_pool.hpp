@@ -0,0 +1,290 @@
+////////////////////////////////////////////////////////////////////////////////
+// node_pool.hpp
+//   Slab allocator for tree nodes.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Massimiliano Rossi
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+/*!
+   \file node_pool.hpp
+   \brief node_pool.hpp Slab allocator for the nodes of the trees.
+   \author Massimiliano Rossi
+   \date 20/10/2021
+*/
+
+#ifndef _NODE_POOL_HH
+#define _NODE_POOL_HH
+
+#include <vector>
+#include <memory>
+#include <new>
+#include <utility>
+#include <cstddef>
+
+/*!
+* Slab allocator for objects of type T.
+* Objects are carved out of chunks of contiguous memory, whose capacity doubles
+* from min_chunk up to max_chunk objects. Released objects are recycled through
+* an intrusive free list. The chunks are released all at once, without visiting
+* the objects: the owner is responsible for destroying non-trivial objects
+* before calling clear().
+* A pool can be shared by several trees, e.g., after a split. When two trees
+* with different pools are joined, the pools are merged: the memory of one pool
+* is moved to the other one, and the emptied pool forwards all the requests to
+* the pool that received its memory.
+*/
+template< typename T>
+class node_pool : public std::enable_shared_from_this< node_pool<T> >{
+public:
+
+    static const size_t min_chunk = 64;
+    static const size_t max_chunk = 1 << 20;
+
+    /*!
+    * Costructor
+    */
+    node_pool():
+        chunks(),
+        forward(nullptr),
+        free_list(nullptr),
+        next(nullptr),
+        last(nullptr),
+        chunk_cap(min_chunk),
+        n_used(0),
+        n_capacity(0)
+    {
+        static_assert(sizeof(T) >= sizeof(void*), "node_pool requires objects at least as large as a pointer");
+    }
+
+    node_pool(const node_pool&) = delete;
+    node_pool& operator=(const node_pool&) = delete;
+
+    /*!
+    * Desctructor
+    */
+    ~node_pool()
+    {
+        clear();
+    }
+
+    /*!
+     * Construct a new object in the pool.
+     * @param args  the arguments forwarded to the constructor of T.
+     * @return      the pointer to the new object.
+     */
+    template< typename... Args>
+    T* create(Args&&... args)
+    {
+        return new(resolve().allocate()) T(std::forward<Args>(args)...);
+    }
+
+    /*!
+     * Destroy an object and recycle its memory.
+     * @param obj  the object to be destroyed.
+     */
+    void destroy(T* obj)
+    {
+        obj->~T();
+        node_pool& p = resolve();
+        *reinterpret_cast<void**>(obj) = p.free_list;
+        p.free_list = obj;
+        p.n_used--;
+    }
+
+    /*!
+     * Allocate the memory for count contiguous objects in a dedicated chunk.
+     * The objects have to be constructed by the caller, and are accounted as
+     * live objects.
+     * @param count the number of objects.
+     * @return      the pointer to the first object.
+     */
+    T* allocate_block(size_t count)
+    {
+        node_pool& p = resolve();
+        T* block = static_cast<T*>(::operator new(count * sizeof(T)));
+        p.chunks.push_back(block);
+        p.n_capacity += count;
+        p.n_used += count;
+        return block;
+    }
+
+    /*!
+     * Merge the memory of another pool into this one. The objects of both
+     * pools may then be released in either of them. The pools must be owned
+     * by std::shared_ptr.
+     * @param other the pool to be merged.
+     */
+    void merge(node_pool& other)
+    {
+        node_pool& a = resolve();
+        node_pool& b = other.resolve();
+        if(&a == &b)
+            return;
+
+        a.chunks.insert(a.chunks.end(), b.chunks.begin(), b.chunks.end());
+        b.chunks.clear();
+        while(b.free_list != nullptr)
+        {
+            void* obj = b.free_list;
+            b.free_list = *reinterpret_cast<void**>(obj);
+            *reinterpret_cast<void**>(obj) = a.free_list;
+            a.free_list = obj;
+        }
+        // Keep the partially used chunk with more room.
+        if(b.last - b.next > a.last - a.next)
+        {
+            a.next = b.next;
+            a.last = b.last;
+        }
+        a.n_used += b.n_used;
+        a.n_capacity += b.n_capacity;
+        b.clear();
+        b.forward = a.shared_from_this();
+    }
+
+    /*!
+     * @return true if the pool is not the owner of its memory.
+     */
+    inline bool is_forward() const
+    {
+        return forward != nullptr;
+    }
+
+    /*!
+     * Release all the chunks at once. Objects are not destroyed.
+     */
+    void clear()
+    {
+        for(size_t i = 0; i < chunks.size(); ++i)
+            ::operator delete(chunks[i]);
+        chunks.clear();
+        free_list = nullptr;
+        next = last = nullptr;
+        chunk_cap = min_chunk;
+        n_used = n_capacity = 0;
+    }
+
+    /*!
+     * Swap the content of two pools.
+     */
+    void swap(node_pool& other)
+    {
+        chunks.swap(other.chunks);
+        forward.swap(other.forward);
+        std::swap(free_list, other.free_list);
+        std::swap(next, other.next);
+        std::swap(last, other.last);
+        std::swap(chunk_cap, other.chunk_cap);
+        std::swap(n_used, other.n_used);
+        std::swap(n_capacity, other.n_capacity);
+    }
+
+    /*!
+     * @return the number of live objects.
+     */
+    inline size_t size() const
+    {
+        return resolve().n_used;
+    }
+
+    /*!
+     * @return the number of objects that fit in the allocated chunks.
+     */
+    inline size_t capacity() const
+    {
+        return resolve().n_capacity;
+    }
+
+  protected:
+
+    /*!
+     * Return the pool that owns the memory, compressing the forward chain.
+     */
+    node_pool& resolve()
+    {
+        if(forward == nullptr)
+            return *this;
+        while(forward->forward != nullptr)
+            forward = forward->forward;
+        return *forward;
+    }
+
+    const node_pool& resolve() const
+    {
+        const node_pool* p = this;
+        while(p->forward != nullptr)
+            p = p->forward.get();
+        return *p;
+    }
+
+    /*!
+     * Return the memory for one object, from the free list if possible.
+     */
+    void* allocate()
+    {
+        n_used++;
+        if(free_list != nullptr)
+        {
+            void* ret = free_list;
+            free_list = *reinterpret_cast<void**>(free_list);
+            return ret;
+        }
+        if(next == last)
+            add_chunk(chunk_cap);
+        return next++;
+    }
+
+    /*!
+     * Allocate a new chunk able to store cap objects.
+     * @param cap  the capacity of the chunk.
+     */
+    void add_chunk(size_t cap)
+    {
+        next = static_cast<T*>(::operator new(cap * sizeof(T)));
+        last = next + cap;
+        chunks.push_back(next);
+        n_capacity += cap;
+        if(chunk_cap < max_chunk)
+            chunk_cap *= 2;
+    }
+
+  private:
+    std::vector<T*> chunks; // The chunks of memory.
+    std::shared_ptr<node_pool> forward; // The pool that received the memory of this pool.
+    void* free_list;        // The head of the list of released objects.
+    T* next;                // The next free slot in the last chunk.
+    T* last;                // The end of the last chunk.
+    size_t chunk_cap;       // The capacity of the next chunk.
+    size_t n_used;          // The number of live objects.
+    size_t n_capacity;      // The number of slots in the chunks.
+
+}; // node_pool
+
+template< typename T>
+const size_t node_pool<T>::min_chunk;
+
+template< typename T>
+const size_t node_pool<T>::max_chunk;
+
+#endif /* end of include guard: _NODE_POOL_HH */
@@ -0,0 +1,573 @@
+////////////////////////////////////////////////////////////////////////////////
+// persistent_avl_rmq.hpp
+//   Persistent RMQ AVL keeping the versions of the array.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Massimiliano Rossi
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+/*!
+   \file persistent_avl_rmq.hpp
+   \brief persistent_avl_rmq.hpp Compute a dynamic RMQ on any version of the array.
+   \author Massimiliano Rossi
+   \date 20/10/2021
+*/
+
+#ifndef _PERSISTENT_AVL_RMQ_HH
+#define _PERSISTENT_AVL_RMQ_HH
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <cstdint>
+#include <type_traits>
+#include <assert.h>
+#include "node_pool.hpp"
+#include "rmq_ops.hpp"
+
+/*!
+* Persistent dynamic array supporting Range Minimum Queries.
+* Each insert, update and erase creates a new version of the array, copying
+* the O(log n) nodes on the path to the modified element and sharing the
+* others with the previous version. All the versions can be queried. A node is
+* released when neither a version nor another node refers to it, hence a
+* version costs O(log n) memory while it is alive.
+* K is the type of the keys
+* S is the type of the values
+* Op is the aggregate maintained for each subtree, see rmq_ops.hpp
+*/
+template< typename K, typename S, typename Op = rmq_min<S> >
+class persistent_avl_rmq{
+public:
+
+    typedef typename Op::value_type agg_t;
+    typedef uint8_t d_t;
+    typedef size_t version_t;
+
+    typedef struct node_t{
+        K size;           // The number of elements of the subtree.
+        S value;          // The value of the node.
+        agg_t agg;        // The aggregate of the values of the subtree.
+        d_t depth;        // The depth of the node.
+        uint32_t refs;    // The number of nodes and versions referring to the node.
+        node_t *left;     // The pointer to the left child of the node.
+        node_t *right;    // The pointer to the right child of the node.
+
+        /*!
+        * Costructor
+        * The node takes the references to its children.
+        */
+        node_t(node_t* left_, S value_, node_t* right_):
+            size(1),
+            value(value_),
+            agg(Op::lift(value)),
+            depth(1),
+            refs(1),
+            left(left_),
+            right(right_)
+        {
+            if(left != nullptr)
+            {
+                size += left->size;
+                agg = Op::combine(left->agg, agg);
+                depth = left->depth + 1;
+            }
+            if(right != nullptr)
+            {
+                size += right->size;
+                agg = Op::combine(agg, right->agg);
+                depth = std::max<d_t>(depth, right->depth + 1);
+            }
+        }
+
+        /*!
+        * @return the rank of the node in its subtree.
+        */
+        inline K rank() const
+        {
+            return left != nullptr ? left->size : 0;
+        }
+
+    }node_t;
+
+    /*!
+    * Costructor
+    * The version 0 is the empty array.
+    * @param keep_ the number of the last versions kept alive, the older ones
+    *              are released automatically. If 0, the versions are
+    *              released only by release.
+    */
+    persistent_avl_rmq(size_t keep_ = 0):
+        versions(1, nullptr),
+        alive(1, true),
+        keep(keep_),
+        pool()
+    {
+
+    }
+
+    persistent_avl_rmq(const persistent_avl_rmq&) = delete;
+    persistent_avl_rmq& operator=(const persistent_avl_rmq&) = delete;
+
+    /*!
+    * Desctructor
+    */
+    ~persistent_avl_rmq()
+    {
+        if(not std::is_trivially_destructible<node_t>::value)
+            for(version_t v = 0; v < versions.size(); ++v)
+                release(versions[v]);
+    }
+
+    /*!
+     * @return the last version.
+     */
+    inline version_t latest() const
+    {
+        return versions.size() - 1;
+    }
+
+    /*!
+     * @return true if the version has not been released.
+     */
+    inline bool is_alive(version_t version) const
+    {
+        return version < versions.size() and alive[version];
+    }
+
+    /*!
+     * @return the number of elements of the version, 0 if released.
+     */
+    inline K size(version_t version) const
+    {
+        return is_alive(version) ? get_size(versions[version]) : 0;
+    }
+
+    /*!
+     * @return the number of elements of the last version.
+     */
+    inline K size() const
+    {
+        return size(latest());
+    }
+
+    /*!
+     * Access a version of the array.
+     * @param version the version.
+     * @param rank    the rank of the element to be accessed.
+     */
+    S access(version_t version, K rank) const
+    {
+        if(rank >= size(version))
+            return 0;
+        const node_t* node = versions[version];
+        while(true)
+        {
+            const K node_rank = node->rank();
+            if(rank < node_rank)
+                node = node->left;
+            else if(rank > node_rank)
+            {
+                rank -= node_rank + 1;
+                node = node->right;
+            }
+            else
+                return node->value;
+        }
+    }
+
+    /*!
+     * Access the last version of the array.
+     * @param rank  the rank of the element to be accessed.
+     */
+    S operator[](K rank) const
+    {
+        return access(latest(), rank);
+    }
+
+    /*!
+     * Computes the aggregate of the interval [left, right) of a version, by
+     * default its minimum.
+     * @param version the version, the identity is returned if released.
+     * @param left    the left boundary interval (includisve).
+     * @param right   the right boundary of the interval (exclusive).
+     */
+    agg_t query(version_t version, K left, K right) const
+    {
+        if(right > size(version))
+            right = size(version);
+        if(left >= right)
+            return Op::identity();
+        return min_range(versions[version], left, right);
+    }
+
+    /*!
+     * Computes the aggregate of the interval [left, right) of the last version.
+     * @param left  the left boundary interval (includisve).
+     * @param right the right boundary of the interval (exclusive).
+     */
+    agg_t operator()(K left, K right) const
+    {
+        return query(latest(), left, right);
+    }
+
+    /*!
+     * Insert the value before the element with rank rank of the last version.
+     * @param rank  the rank of the element that has to be inserted.
+     * @param value the value information attached to the element.
+     * @return      the new version.
+     */
+    version_t insert(K rank, S value)
+    {
+        const node_t* root = versions[latest()];
+        if(rank > get_size(root))
+            rank = get_size(root);
+        return push_version(insert(root, rank, value));
+    }
+
+    /*!
+     * Update the value with rank rank of the last version.
+     * @param rank  the rank of the element that has to be updated.
+     * @param value the value information attached to the element.
+     * @return      the new version, equal to the last one if rank is out of range.
+     */
+    version_t update(K rank, S value)
+    {
+        const node_t* root = versions[latest()];
+        if(rank >= get_size(root))
+            return latest();
+        return push_version(update(root, rank, value));
+    }
+
+    /*!
+     * Remove the element with rank rank of the last version.
+     * @param rank  the rank of the element that has to be removed.
+     * @return      the new version, equal to the last one if rank is out of range.
+     */
+    version_t erase(K rank)
+    {
+        const node_t* root = versions[latest()];
+        if(rank >= get_size(root))
+            return latest();
+        return push_version(erase(root, rank));
+    }
+
+    /*!
+     * Release a version, the nodes not shared with other versions are
+     * released. The last version can not be released.
+     * @param version the version.
+     */
+    void release(version_t version)
+    {
+        if(not is_alive(version) or version == latest())
+            return;
+        release(versions[version]);
+        versions[version] = nullptr;
+        alive[version] = false;
+    }
+
+    /*!
+     * @return the number of nodes of all the alive versions.
+     */
+    inline size_t n_nodes() const
+    {
+        return pool.size();
+    }
+
+    /*!
+     * @return a version of the array as an std::vector.
+     */
+    std::vector<S> to_vector(version_t version) const
+    {
+        std::vector<S> res;
+        if(is_alive(version))
+        {
+            res.reserve(size(version));
+            to_vector(versions[version], res);
+        }
+        return res;
+    }
+
+    /*!
+     * Print a version of the array.
+     */
+    void print(version_t version) const
+    {
+        std::vector<S> vec = to_vector(version);
+        for(size_t i = 0; i < vec.size(); ++i)
+            std::cout << vec[i] << " ";
+        std::cout << std::endl;
+    }
+
+  protected:
+
+    /*!
+     * Append a new version, releasing the oldest ones if needed.
+     * @return the new version.
+     */
+    version_t push_version(node_t* root)
+    {
+        versions.push_back(root);
+        alive.push_back(true);
+        const version_t last = latest();
+        if(keep > 0 and last >= keep)
+            release(last - keep);
+        return last;
+    }
+
+    static inline K get_size(const node_t* node)
+    {
+        return node == nullptr ? 0 : node->size;
+    }
+
+    static inline d_t get_depth(const node_t* node)
+    {
+        return node == nullptr ? 0 : node->depth;
+    }
+
+    static inline agg_t get_agg(const node_t* node)
+    {
+        return node == nullptr ? Op::identity() : node->agg;
+    }
+
+    /*!
+     * Take a new reference to the node.
+     */
+    static inline node_t* retain(const node_t* node)
+    {
+        node_t* res = const_cast<node_t*>(node);
+        if(res != nullptr)
+            res->refs++;
+        return res;
+    }
+
+    /*!
+     * Drop a reference to the node, releasing the nodes that have no more
+     * references.
+     */
+    void release(node_t* node)
+    {
+        std::vector<node_t*> stack;
+        if(node != nullptr)
+            stack.push_back(node);
+        while(not stack.empty())
+        {
+            node_t* curr = stack.back();
+            stack.pop_back();
+            if(--curr->refs > 0)
+                continue;
+            if(curr->left != nullptr)
+                stack.push_back(curr->left);
+            if(curr->right != nullptr)
+                stack.push_back(curr->right);
+            pool.destroy(curr);
+        }
+    }
+
+    /*!
+     * Create a node, taking the references to the children.
+     */
+    inline node_t* make(node_t* left, const S& value, node_t* right)
+    {
+        return pool.create(left, value, right);
+    }
+
+    /*!
+     * Create a balanced node, taking the references to the children, whose
+     * depths differ by at most two.
+     */
+    node_t* balance(node_t* left, const S& value, node_t* right)
+    {
+        const d_t l_depth = get_depth(left);
+        const d_t r_depth = get_depth(right);
+        if(l_depth > r_depth + 1)
+        {
+            node_t* res;
+            if(get_depth(left->left) >= get_depth(left->right))
+                res = make(retain(left->left), left->value, make(retain(left->right), value, right));
+            else
+            {
+                const node_t* lr = left->right;
+                res = make(make(retain(left->left), left->value, retain(lr->left)), lr->value, make(retain(lr->right), value, right));
+            }
+            release(left);
+            return res;
+        }
+        if(r_depth > l_depth + 1)
+        {
+            node_t* res;
+            if(get_depth(right->right) >= get_depth(right->left))
+                res = make(make(left, value, retain(right->left)), right->value, retain(right->right));
+            else
+            {
+                const node_t* rl = right->left;
+                res = make(make(left, value, retain(rl->left)), rl->value, make(retain(rl->right), right->value, retain(right->right)));
+            }
+            release(right);
+            return res;
+        }
+        return make(left, value, right);
+    }
+
+    /*!
+     * @return the new root of the subtree with the value inserted.
+     */
+    node_t* insert(const node_t* node, K rank, const S& value)
+    {
+        if(node == nullptr)
+            return make(nullptr, value, nullptr);
+        const K node_rank = node->rank();
+        if(rank <= node_rank)
+            return balance(insert(node->left, rank, value), node->value, retain(node->right));
+        return balance(retain(node->left), node->value, insert(node->right, rank - node_rank - 1, value));
+    }
+
+    /*!
+     * @return the new root of the subtree with the value updated.
+     */
+    node_t* update(const node_t* node, K rank, const S& value)
+    {
+        const K node_rank = node->rank();
+        if(rank < node_rank)
+            return make(update(node->left, rank, value), node->value, retain(node->right));
+        if(rank > node_rank)
+            return make(retain(node->left), node->value, update(node->right, rank - node_rank - 1, value));
+        return make(retain(node->left), value, retain(node->right));
+    }
+
+    /*!
+     * @return the new root of the subtree with the element removed.
+     */
+    node_t* erase(const node_t* node, K rank)
+    {
+        const K node_rank = node->rank();
+        if(rank < node_rank)
+            return balance(erase(node->left, rank), node->value, retain(node->right));
+        if(rank > node_rank)
+            return balance(retain(node->left), node->value, erase(node->right, rank - node_rank - 1));
+        if(node->left == nullptr)
+            return retain(node->right);
+        if(node->right == nullptr)
+            return retain(node->left);
+        // Replace the element with its successor.
+        S min;
+        node_t* right = erase_min(node->right, min);
+        return balance(retain(node->left), min, right);
+    }
+
+    /*!
+     * @return the new root of the subtree without its first element.
+     * @param min set to the first element.
+     */
+    node_t* erase_min(const node_t* node, S& min)
+    {
+        if(node->left == nullptr)
+        {
+            min = node->value;
+            return retain(node->right);
+        }
+        return balance(erase_min(node->left, min), node->value, retain(node->right));
+    }
+
+    /*!
+     * Computes the aggregate of the interval [left, right), with left < right,
+     * as avl_rmq::min_range.
+     */
+    static agg_t min_range(const node_t* node, K left, K right)
+    {
+        while(node != nullptr)
+        {
+            const K node_rank = node->rank();
+            if(node_rank >= right)
+                node = node->left;
+            else if(node_rank < left)
+            {
+                left -= node_rank + 1;
+                right -= node_rank + 1;
+                node = node->right;
+            }
+            else
+                break;
+        }
+        if(node == nullptr)
+            return Op::identity();
+
+        agg_t agg = Op::lift(node->value);
+
+        const node_t* curr = node->left;
+        while(curr != nullptr)
+        {
+            if(left == 0)
+            {
+                agg = Op::combine(curr->agg, agg);
+                break;
+            }
+            const K curr_rank = curr->rank();
+            if(left <= curr_rank)
+            {
+                agg = Op::combine(Op::lift(curr->value), Op::combine(get_agg(curr->right), agg));
+                curr = curr->left;
+            }
+            else
+            {
+                left -= curr_rank + 1;
+                curr = curr->right;
+            }
+        }
+
+        right -= node->rank() + 1;
+        curr = node->right;
+        while(curr != nullptr and right > 0)
+        {
+            const K curr_rank = curr->rank();
+            if(right > curr_rank)
+            {
+                agg = Op::combine(Op::combine(agg, get_agg(curr->left)), Op::lift(curr->value));
+                right -= curr_rank + 1;
+                curr = curr->right;
+            }
+            else
+                curr = curr->left;
+        }
+        return agg;
+    }
+
+    static void to_vector(const node_t* node, std::vector<S>& vec)
+    {
+        if(node == nullptr) return;
+
+        to_vector(node->left, vec);
+        vec.push_back(node->value);
+        to_vector(node->right, vec);
+    }
+
+  private:
+    std::vector<node_t*> versions;  // The roots of the versions.
+    std::vector<bool> alive;        // Whether each version is alive.
+    size_t keep;                    // The number of versions kept alive, 0 for all.
+    node_pool<node_t> pool;         // The memory of the nodes.
+
+}; // persistent_avl_rmq
+
+#endif /* end of include guard: _PERSISTENT_AVL_RMQ_HH */
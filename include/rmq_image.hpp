@@ -0,0 +1,362 @@
+////////////////////////////////////////////////////////////////////////////////
+// rmq_image.hpp
+//   Binary image of the dynamic rmq data structures.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Massimiliano Rossi
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+/*!
+   \file rmq_image.hpp
+   \brief rmq_image.hpp Binary image of the dynamic rmq data structures.
+   \author Massimiliano Rossi
+   \date 20/10/2021
+*/
+
+#ifndef _RMQ_IMAGE_HH
+#define _RMQ_IMAGE_HH
+
+#include <istream>
+#include <ostream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include "rmq_ops.hpp"
+
+/*!
+* The image stores, in the native byte order:
+* - the header;
+* - the n values of the array, in order;
+* - a complete binary tree over the aggregates of the blocks of
+*   rmq_image_header::block consecutive values, stored as an array of
+*   2 * leaves aggregates, where the children of i are 2i and 2i + 1, and the
+*   leaves start at leaves. Unused leaves store the identity.
+* Each section starts at an offset multiple of 64 bytes, so that the image can
+* be memory mapped and queried in place.
+*/
+typedef struct rmq_image_header{
+    char magic[8];          // The string "DYNRMQ".
+    uint32_t version;       // The version of the format.
+    uint32_t key_size;      // The size of the keys.
+    uint32_t value_size;    // The size of the values.
+    uint32_t agg_size;      // The size of the aggregates.
+    uint64_t agg_id;        // The identifier of the aggregate, see rmq_agg_id.
+    uint64_t n;             // The number of values.
+    uint64_t block;         // The number of values of each block.
+    uint64_t leaves;        // The number of leaves of the block tree.
+    uint64_t values_offset; // The offset of the values in bytes.
+    uint64_t tree_offset;   // The offset of the block tree in bytes.
+
+    static const uint32_t current_version = 2;
+    static const uint64_t default_block = 64;
+    static const uint64_t alignment = 64;
+
+    /*!
+     * Fill the header of an image of n values, aggregated by Op.
+     */
+    template< typename K, typename S, typename Op>
+    void init(uint64_t n_)
+    {
+        typedef typename Op::value_type A;
+        std::memset(this, 0, sizeof(rmq_image_header));
+        std::memcpy(magic, "DYNRMQ", 6);
+        version = current_version;
+        key_size = sizeof(K);
+        value_size = sizeof(S);
+        agg_size = sizeof(A);
+        agg_id = rmq_agg_id<Op>::value();
+        n = n_;
+        block = default_block;
+        const uint64_t n_blocks = (n + block - 1) / block;
+        leaves = 1;
+        while(leaves < n_blocks)
+            leaves *= 2;
+        values_offset = align(sizeof(rmq_image_header));
+        tree_offset = align(values_offset + n * sizeof(S));
+    }
+
+    /*!
+     * @return true if the header describes a valid image with the given types
+     *         and aggregate: the n values fit in K and lie between the header
+     *         and the block tree, the tree has a leaf for each block and both
+     *         sections are aligned. The bounds are checked without overflows, so that a
+     *         corrupted header is rejected before its sizes are used.
+     */
+    template< typename K, typename S, typename Op>
+    bool check() const
+    {
+        typedef typename Op::value_type A;
+        const uint64_t max_u64 = std::numeric_limits<uint64_t>::max();
+        if(std::memcmp(magic, "DYNRMQ", 6) != 0 or
+            version != current_version or
+            key_size != sizeof(K) or
+            value_size != sizeof(S) or
+            agg_size != sizeof(A) or
+            agg_id != rmq_agg_id<Op>::value() or
+            block == 0)
+            return false;
+        if(n > static_cast<uint64_t>(std::numeric_limits<K>::max()))
+            return false;
+        if(values_offset < sizeof(rmq_image_header) or
+            values_offset % alignment != 0 or
+            tree_offset % alignment != 0)
+            return false;
+        if(n > (max_u64 - values_offset) / sizeof(S) or
+            values_offset + n * sizeof(S) > tree_offset)
+            return false;
+        if(leaves == 0 or leaves < n / block + (n % block != 0 ? 1 : 0))
+            return false;
+        return leaves <= (max_u64 - tree_offset) / (2 * sizeof(A));
+    }
+
+    /*!
+     * @return the size of the image in bytes.
+     */
+    inline uint64_t size() const
+    {
+        return tree_offset + 2 * leaves * agg_size;
+    }
+
+    static inline uint64_t align(uint64_t offset)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+}rmq_image_header;
+
+/*!
+* Writes an image, receiving the values one at a time in order.
+*/
+template< typename K, typename S, typename Op>
+class rmq_image_writer{
+public:
+    typedef typename Op::value_type agg_t;
+
+    /*!
+     * Costructor. Writes the header of an image of n values.
+     * @param out_ the output stream.
+     * @param n     the number of values.
+     */
+    rmq_image_writer(std::ostream& out_, uint64_t n):
+        out(out_),
+        header(),
+        tree(),
+        buffer(),
+        written(0),
+        pos(0)
+    {
+        static_assert(std::is_trivially_copyable<S>::value, "the values must be trivially copyable");
+        static_assert(std::is_trivially_copyable<agg_t>::value, "the aggregates must be trivially copyable");
+        header.init<K,S,Op>(n);
+        tree.assign(2 * header.leaves, Op::identity());
+        buffer.reserve(buffer_size);
+        write(&header, sizeof(header));
+        pad(header.values_offset);
+    }
+
+    /*!
+     * Append the next value of the array.
+     */
+    inline void push(const S& value)
+    {
+        agg_t& leaf = tree[header.leaves + pos / header.block];
+        leaf = Op::combine(leaf, Op::lift(value));
+        ++pos;
+        buffer.push_back(value);
+        if(buffer.size() == buffer_size)
+            flush();
+    }
+
+    /*!
+     * Write the block tree. All the values must have been pushed.
+     * @return false if the output failed.
+     */
+    bool finish()
+    {
+        flush();
+        pad(header.tree_offset);
+        for(uint64_t i = header.leaves - 1; i > 0; --i)
+            tree[i] = Op::combine(tree[2 * i], tree[2 * i + 1]);
+        write(tree.data(), tree.size() * sizeof(agg_t));
+        return pos == header.n and out.good();
+    }
+
+  protected:
+
+    void flush()
+    {
+        write(buffer.data(), buffer.size() * sizeof(S));
+        buffer.clear();
+    }
+
+    void pad(uint64_t offset)
+    {
+        static const char zeros[rmq_image_header::alignment] = {0};
+        if(written < offset)
+            write(zeros, offset - written);
+    }
+
+    void write(const void* data, size_t bytes)
+    {
+        out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+        written += bytes;
+    }
+
+  private:
+    static const size_t buffer_size = 4096;
+
+    std::ostream& out;
+    rmq_image_header header;
+    std::vector<agg_t> tree;    // The block tree.
+    std::vector<S> buffer;      // The values not yet written.
+    uint64_t written;           // The number of bytes written.
+    uint64_t pos;               // The number of values pushed.
+
+}; // rmq_image_writer
+
+template< typename K, typename S, typename Op>
+const size_t rmq_image_writer<K,S,Op>::buffer_size;
+
+/*!
+* Reads the values of an image one at a time, in order. It can be used as the
+* input iterator of a linear time construction.
+*/
+template< typename K, typename S, typename Op>
+class rmq_image_reader{
+public:
+    typedef typename Op::value_type agg_t;
+
+    /*!
+     * Costructor. Reads and checks the header of the image. If the stream is
+     * seekable, the image must also fit in the rest of the stream.
+     * @param in_ the input stream.
+     */
+    rmq_image_reader(std::istream& in_):
+        in(in_),
+        header(),
+        buffer(),
+        pos(0),
+        consumed(0),
+        valid(false)
+    {
+        in.read(reinterpret_cast<char*>(&header), sizeof(header));
+        valid = in.good() and header.check<K,S,Op>() and fits();
+        if(valid)
+            in.ignore(static_cast<std::streamsize>(header.values_offset - sizeof(header)));
+        if(valid)
+            buffer.reserve(buffer_size);
+        fill();
+    }
+
+    /*!
+     * @return true if the header is valid and all the reads succeeded. A
+     *         reader with an invalid header reads no values.
+     */
+    inline bool good() const
+    {
+        return valid and in.good();
+    }
+
+    /*!
+     * @return the number of values of the image.
+     */
+    inline uint64_t size() const
+    {
+        return valid ? header.n : 0;
+    }
+
+    inline const S& operator*() const
+    {
+        return buffer[pos];
+    }
+
+    inline rmq_image_reader& operator++()
+    {
+        if(++pos == buffer.size())
+            fill();
+        return *this;
+    }
+
+    /*!
+     * Skip the end of the image, after all the values have been read.
+     */
+    void finish()
+    {
+        if(valid)
+            in.ignore(static_cast<std::streamsize>(header.size() - header.values_offset - header.n * sizeof(S)));
+    }
+
+  protected:
+
+    /*!
+     * @return false if the stream is seekable and ends before the image.
+     */
+    bool fits()
+    {
+        const std::streampos here = in.tellg();
+        if(here == std::streampos(-1))
+            return true;
+        in.seekg(0, std::ios::end);
+        const std::streampos end = in.tellg();
+        in.seekg(here);
+        if(end == std::streampos(-1) or not in.good())
+        {
+            in.clear();
+            in.seekg(here);
+            return in.good();
+        }
+        return static_cast<uint64_t>(end - here) >= header.size() - sizeof(header);
+    }
+
+    void fill()
+    {
+        pos = 0;
+        const uint64_t count = std::min<uint64_t>(buffer_size, size() - consumed);
+        buffer.resize(count > 0 ? count : 1);
+        if(count > 0)
+        {
+            in.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(count * sizeof(S)));
+            consumed += count;
+        }
+    }
+
+  private:
+    static const size_t buffer_size = 4096;
+
+    std::istream& in;
+    rmq_image_header header;
+    std::vector<S> buffer;      // The values read and not yet consumed.
+    size_t pos;                 // The position of the next value in the buffer.
+    uint64_t consumed;          // The number of values read from the stream.
+    bool valid;                 // Whether the header is valid.
+
+}; // rmq_image_reader
+
+template< typename K, typename S, typename Op>
+const size_t rmq_image_reader<K,S,Op>::buffer_size;
+
+#endif /* end of include guard: _RMQ_IMAGE_HH */
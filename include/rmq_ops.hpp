@@ -0,0 +1,255 @@
+////////////////////////////////////////////////////////////////////////////////
+// rmq_ops.hpp
+//   Aggregates maintained by the dynamic rmq data structures.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Massimiliano Rossi
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+/*!
+   \file rmq_ops.hpp
+   \brief rmq_ops.hpp Aggregates maintained by the dynamic rmq data structures.
+   \author Massimiliano Rossi
+   \date 20/10/2021
+*/
+
+#ifndef _RMQ_OPS_HH
+#define _RMQ_OPS_HH
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <assert.h>
+
+/*!
+* An aggregate is a monoid over the values of the array. It provides:
+* - value_type: the type of the aggregate;
+* - identity(): the aggregate of the empty array;
+* - lift(v): the aggregate of the array containing only v;
+* - combine(a, b): the aggregate of the concatenation of two arrays, whose
+*   aggregates are a and b. It must be associative, but it needs not be
+*   commutative.
+* Selection aggregates, whose value is one of the values of the array, also
+* provide less(a, b), the order in which the aggregate selects the smallest
+* value. They support argmin, min_with_pos and the threshold searches.
+* Aggregates supporting range updates also provide:
+* - add(a, d, n): the aggregate of n values whose aggregate is a, after 
+*   adding d to each of them;
+* - assign(v, n): the aggregate of n values equal to v.
+* They are enabled by wrapping the aggregate in rmq_lazy.
+* An aggregate can also provide storage_type, the type in which the trees store
+* the values, when it is narrower than the type of the values exposed by the
+* interface, and agg_storage_type, the type in which they store the aggregates
+* of the subtrees. The interface still takes and returns S and value_type: the
+* stored values and aggregates are widened when read, and each of them must
+* fit in the narrower type, which is asserted when they are stored. The 
+* aggregates below take the storage type as their last template parameter, S
+* by default.
+* An aggregate can finally provide id(), a number identifying it in the binary
+* images, see rmq_image.hpp. The aggregates without it have id 0.
+*/
+
+template< typename T>
+struct rmq_void{
+    typedef void type;
+};
+
+/*!
+* The type in which the values are stored: Op::storage_type if provided,
+* otherwise S.
+*/
+template< typename Op, typename S, typename = void>
+struct rmq_storage{
+    typedef S type;
+};
+
+template< typename Op, typename S>
+struct rmq_storage<Op, S, typename rmq_void<typename Op::storage_type>::type>{
+    typedef typename Op::storage_type type;
+};
+
+/*!
+* The type in which the aggregates are stored: Op::agg_storage_type if
+* provided, otherwise Op::value_type.
+*/
+template< typename Op, typename = void>
+struct rmq_agg_storage{
+    typedef typename Op::value_type type;
+};
+
+template< typename Op>
+struct rmq_agg_storage<Op, typename rmq_void<typename Op::agg_storage_type>::type>{
+    typedef typename Op::agg_storage_type type;
+};
+
+/*!
+* The identifier of the aggregate: Op::id() if provided, otherwise 0.
+*/
+template< typename Op, typename = void>
+struct rmq_agg_id{
+    static inline uint64_t value() { return 0; }
+};
+
+template< typename Op>
+struct rmq_agg_id<Op, typename rmq_void<decltype(Op::id())>::type>{
+    static inline uint64_t value() { return Op::id(); }
+};
+
+/*!
+* Conversion of a value of type T to the storage type U, asserting that the
+* value fits in U. It does nothing if the types are the same.
+*/
+template< typename T, typename U>
+struct rmq_narrow{
+    static inline U store(const T& v)
+    {
+        assert(static_cast<T>(static_cast<U>(v)) == v);
+        return static_cast<U>(v);
+    }
+};
+
+template< typename T>
+struct rmq_narrow<T,T>{
+    static inline const T& store(const T& v) { return v; }
+    static inline T&& store(T&& v) { return std::move(v); }
+};
+
+/*!
+* Range minimum, the default aggregate. The values and the minimums are stored
+* in the type V.
+*/
+template< typename S, typename V = S>
+struct rmq_min{
+    typedef S value_type;
+    typedef V storage_type;
+    typedef V agg_storage_type;
+
+    static inline uint64_t id() { return 1; }
+    static inline value_type identity() { return std::numeric_limits<S>::max(); }
+    static inline value_type lift(const S& v) { return v; }
+    static inline value_type combine(const value_type& a, const value_type& b) { return std::min(a, b); }
+    static inline bool less(const S& a, const S& b) { return a < b; }
+    static inline value_type add(const value_type& a, const S& d, size_t) { return a + d; }
+    static inline value_type assign(const S& v, size_t) { return v; }
+};
+
+/*!
+* Range maximum. The selection is reversed: argmin returns the position of the
+* leftmost maximum, and the threshold searches look for values above the
+* threshold. The values and the maximums are stored in the type V.
+*/
+template< typename S, typename V = S>
+struct rmq_max{
+    typedef S value_type;
+    typedef V storage_type;
+    typedef V agg_storage_type;
+
+    static inline uint64_t id() { return 2; }
+    static inline value_type identity() { return std::numeric_limits<S>::lowest(); }
+    static inline value_type lift(const S& v) { return v; }
+    static inline value_type combine(const value_type& a, const value_type& b) { return std::max(a, b); }
+    static inline bool less(const S& a, const S& b) { return b < a; }
+    static inline value_type add(const value_type& a, const S& d, size_t) { return a + d; }
+    static inline value_type assign(const S& v, size_t) { return v; }
+};
+
+/*!
+* Range sum, accumulated in the type T. The values are stored in the type V.
+*/
+template< typename S, typename T = S, typename V = S>
+struct rmq_sum{
+    typedef T value_type;
+    typedef V storage_type;
+
+    static inline uint64_t id() { return 3; }
+    static inline value_type identity() { return T(0); }
+    static inline value_type lift(const S& v) { return static_cast<T>(v); }
+    static inline value_type combine(const value_type& a, const value_type& b) { return a + b; }
+    static inline value_type add(const value_type& a, const S& d, size_t n) { return a + static_cast<T>(d) * static_cast<T>(n); }
+    static inline value_type assign(const S& v, size_t n) { return static_cast<T>(v) * static_cast<T>(n); }
+};
+
+/*!
+* Range minimum and the number of its occurrences, counted in the type C.
+*/
+template< typename S, typename C = size_t>
+struct rmq_min_count{
+    typedef std::pair<S,C> value_type;
+
+    static inline uint64_t id() { return 4; }
+    static inline value_type identity() { return value_type(std::numeric_limits<S>::max(), 0); }
+    static inline value_type lift(const S& v) { return value_type(v, 1); }
+    static inline value_type combine(const value_type& a, const value_type& b)
+    {
+        if(a.first < b.first)
+            return a;
+        if(b.first < a.first)
+            return b;
+        return value_type(a.first, a.second + b.second);
+    }
+    static inline value_type add(const value_type& a, const S& d, size_t) { return value_type(a.first + d, a.second); }
+    static inline value_type assign(const S& v, size_t n) { return value_type(v, static_cast<C>(n)); }
+};
+
+/*!
+* Two aggregates maintained together in the same node. Its id depends on the
+* ids of both aggregates, and on their order.
+*/
+template< typename Op1, typename Op2>
+struct rmq_fuse{
+    typedef std::pair<typename Op1::value_type, typename Op2::value_type> value_type;
+
+    static inline uint64_t id() { return (rmq_agg_id<Op1>::value() * 1099511628211ULL) ^ (rmq_agg_id<Op2>::value() + 0x100); }
+    static inline value_type identity() { return value_type(Op1::identity(), Op2::identity()); }
+    template< typename S>
+    static inline value_type lift(const S& v) { return value_type(Op1::lift(v), Op2::lift(v)); }
+    static inline value_type combine(const value_type& a, const value_type& b)
+    {
+        return value_type(Op1::combine(a.first, b.first), Op2::combine(a.second, b.second));
+    }
+    template< typename S>
+    static inline value_type add(const value_type& a, const S& d, size_t n) { return value_type(Op1::add(a.first, d, n), Op2::add(a.second, d, n)); }
+    template< typename S>
+    static inline value_type assign(const S& v, size_t n) { return value_type(Op1::assign(v, n), Op2::assign(v, n)); }
+};
+
+/*!
+* Base of the aggregates supporting range updates.
+*/
+struct rmq_lazy_tag{};
+
+/*!
+* Enables the range updates for the aggregate Op. The nodes of the tree store
+* the size of their subtree and a pending update of the values of the 
+* subtree, that is pushed to the children when they are visited. The pending
+* updates are not part of the images, that are the same as the ones of Op.
+*/
+template< typename Op>
+struct rmq_lazy : public Op, public rmq_lazy_tag{
+    static inline uint64_t id() { return rmq_agg_id<Op>::value(); }
+};
+
+#endif /* end of include guard: _RMQ_OPS_HH */
@@ -0,0 +1,319 @@
+////////////////////////////////////////////////////////////////////////////////
+// rmq_stats.hpp
+//   Instrumentation policies of the dynamic rmq data structures.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Massimiliano Rossi
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+/*!
+   \file rmq_stats.hpp
+   \brief rmq_stats.hpp Instrumentation policies of the dynamic rmq data structures.
+   \author Massimiliano Rossi
+   \date 20/10/2021
+*/
+
+#ifndef _RMQ_STATS_HH
+#define _RMQ_STATS_HH
+
+#include <iostream>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+/*!
+* Operations recorded by the statistics policies. The batch and range
+* operations are recorded once per call, together with the number of elements
+* they process. RMQ_SEARCH covers min_with_pos, argmin and the find_*_below.
+*/
+enum rmq_op { RMQ_ACCESS = 0, RMQ_INSERT = 1, RMQ_UPDATE = 2, RMQ_ERASE = 3, RMQ_QUERY = 4,
+    RMQ_INSERT_BATCH = 5, RMQ_UPDATE_BATCH = 6, RMQ_RANGE_UPDATE = 7, RMQ_ERASE_RANGE = 8,
+    RMQ_QUERY_BATCH = 9, RMQ_SEARCH = 10, RMQ_SPLIT = 11, RMQ_JOIN = 12, RMQ_N_OPS = 13 };
+
+/*!
+* Memory used by a tree, in bytes.
+*/
+typedef struct rmq_memory{
+    size_t nodes;   // The memory of the nodes of the tree.
+    size_t slack;   // The memory allocated by the pool and not used by any node.
+    size_t index;   // The memory of the static index built by freeze.
+
+    /*!
+     * @return the total memory.
+     */
+    inline size_t total() const
+    {
+        return nodes + slack + index;
+    }
+}rmq_memory;
+
+/*!
+* The default statistics policy, that records nothing. All its methods are
+* empty and are compiled out.
+*/
+struct rmq_no_stats{
+
+    /*!
+    * Measures the latency of an operation, from its construction to its
+    * destruction.
+    */
+    struct timer{
+        inline timer(rmq_no_stats&, rmq_op, size_t = 1) { }
+    };
+
+    inline void visit(rmq_op, size_t = 1) { }
+    inline void rotation() { }
+    inline void depth(size_t) { }
+};
+
+/*!
+* Statistics policy counting the operations and the elements they process, the
+* nodes visited by each kind of operation, the rotations and the depth of the
+* tree after each insertion and deletion. The latencies of the operations are collected in histograms
+* with logarithmic buckets: bucket i counts the operations that took less
+* than 2^i nanoseconds, and at least 2^(i-1).
+* Reading the clock costs tens of nanoseconds per operation, this policy is
+* meant for diagnostics and not for production builds.
+*/
+class rmq_stats{
+public:
+
+    static const size_t n_buckets = 48;  // The number of latency buckets.
+    static const size_t max_depth = 128; // The largest depth recorded.
+
+    /*!
+    * Measures the latency of an operation processing n elements, from its
+    * construction to its destruction.
+    */
+    struct timer{
+        rmq_stats& stats;
+        rmq_op op;
+        size_t n;
+        std::chrono::steady_clock::time_point start;
+
+        inline timer(rmq_stats& stats_, rmq_op op_, size_t n_ = 1):
+            stats(stats_),
+            op(op_),
+            n(n_),
+            start(std::chrono::steady_clock::now())
+        {
+
+        }
+
+        inline ~timer()
+        {
+            const std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start;
+            stats.record(op, static_cast<uint64_t>(elapsed.count()), n);
+        }
+    };
+
+    /*!
+    * Costructor
+    */
+    rmq_stats():
+        counts(),
+        items(),
+        visits(),
+        nanos(),
+        latencies(),
+        depths(),
+        rotations(0)
+    {
+
+    }
+
+    /*!
+     * Clear all the counters.
+     */
+    void reset()
+    {
+        for(size_t i = 0; i < RMQ_N_OPS; ++i)
+        {
+            counts[i] = 0;
+            items[i] = 0;
+            visits[i] = 0;
+            nanos[i] = 0;
+            for(size_t j = 0; j < n_buckets; ++j)
+                latencies[i][j] = 0;
+        }
+        for(size_t i = 0; i <= max_depth; ++i)
+            depths[i] = 0;
+        rotations = 0;
+    }
+
+    /*!
+     * Accounts n nodes visited by an operation.
+     */
+    inline void visit(rmq_op op, size_t n = 1)
+    {
+        visits[op] += n;
+    }
+
+    /*!
+     * Accounts a rotation.
+     */
+    inline void rotation()
+    {
+        rotations++;
+    }
+
+    /*!
+     * Accounts the depth of the tree after an insertion or a deletion.
+     */
+    inline void depth(size_t d)
+    {
+        if(d > max_depth)
+            d = max_depth;
+        depths[d]++;
+    }
+
+    /*!
+     * Accounts an operation on n elements that took the given nanoseconds.
+     */
+    inline void record(rmq_op op, uint64_t ns, size_t n = 1)
+    {
+        counts[op]++;
+        items[op] += n;
+        nanos[op] += ns;
+        size_t bucket = 0;
+        while(bucket + 1 < n_buckets and (uint64_t(1) << bucket) <= ns)
+            bucket++;
+        latencies[op][bucket]++;
+    }
+
+    /*!
+     * @return the number of operations of kind op.
+     */
+    inline uint64_t count(rmq_op op) const
+    {
+        return counts[op];
+    }
+
+    /*!
+     * @return the number of elements processed by the operations of kind op,
+     *         the same as count for the single element operations.
+     */
+    inline uint64_t elements(rmq_op op) const
+    {
+        return items[op];
+    }
+
+    /*!
+     * @return the number of nodes visited by the operations of kind op.
+     */
+    inline uint64_t visited(rmq_op op) const
+    {
+        return visits[op];
+    }
+
+    /*!
+     * @return the number of rotations, including the ones of join and split.
+     */
+    inline uint64_t n_rotations() const
+    {
+        return rotations;
+    }
+
+    /*!
+     * @return the number of insertions and deletions that left the tree with
+     *         depth d, where the depths larger than max_depth are accounted
+     *         as max_depth.
+     */
+    inline uint64_t depth_count(size_t d) const
+    {
+        if(d > max_depth)
+            d = max_depth;
+        return depths[d];
+    }
+
+    /*!
+     * @return the number of operations of kind op in the latency bucket i.
+     */
+    inline uint64_t latency_count(rmq_op op, size_t i) const
+    {
+        return latencies[op][i];
+    }
+
+    /*!
+     * @return the smallest power of two of nanoseconds larger than the latency
+     *         of a fraction q of the operations of kind op.
+     */
+    uint64_t latency_quantile(rmq_op op, double q) const
+    {
+        const double target = q * static_cast<double>(counts[op]);
+        uint64_t seen = 0;
+        for(size_t i = 0; i < n_buckets; ++i)
+        {
+            seen += latencies[op][i];
+            if(seen > 0 and static_cast<double>(seen) >= target)
+                return uint64_t(1) << i;
+        }
+        return uint64_t(1) << (n_buckets - 1);
+    }
+
+    /*!
+     * Print a summary of the statistics.
+     * @param out the output stream.
+     */
+    void print(std::ostream& out = std::cout) const
+    {
+        static const char* names[RMQ_N_OPS] = {"access", "insert", "update", "erase", "query",
+            "insert_batch", "update_batch", "range_update", "erase_range", "query_batch", "search", "split", "join"};
+        for(size_t i = 0; i < RMQ_N_OPS; ++i)
+        {
+            if(counts[i] == 0)
+                continue;
+            const rmq_op op = static_cast<rmq_op>(i);
+            const double n = static_cast<double>(counts[i]);
+            out << names[i] << ": " << counts[i] << " ops, ";
+            if(items[i] != counts[i])
+                out << static_cast<double>(items[i]) / n << " elements/op, ";
+            out << static_cast<double>(visits[i]) / n << " nodes/op, "
+                << static_cast<double>(nanos[i]) / n << " ns/op, p50 < "
+                << latency_quantile(op, 0.5) << " ns, p99 < "
+                << latency_quantile(op, 0.99) << " ns" << std::endl;
+        }
+        const uint64_t edited = items[RMQ_INSERT] + items[RMQ_ERASE] + items[RMQ_INSERT_BATCH] + items[RMQ_ERASE_RANGE];
+        out << "rotations: " << rotations;
+        if(edited > 0)
+            out << ", " << static_cast<double>(rotations) / static_cast<double>(edited) << " per inserted or erased element";
+        out << std::endl;
+        size_t deepest = 0;
+        for(size_t d = 0; d <= max_depth; ++d)
+            if(depths[d] > 0)
+                deepest = d;
+        out << "max depth: " << deepest << std::endl;
+    }
+
+  private:
+    uint64_t counts[RMQ_N_OPS];                 // The number of operations.
+    uint64_t items[RMQ_N_OPS];                  // The number of elements processed.
+    uint64_t visits[RMQ_N_OPS];                 // The number of visited nodes.
+    uint64_t nanos[RMQ_N_OPS];                  // The total latency.
+    uint64_t latencies[RMQ_N_OPS][n_buckets];   // The latency histograms.
+    uint64_t depths[max_depth + 1];             // The depth histogram.
+    uint64_t rotations;                         // The number of rotations.
+
+}; // rmq_stats
+
+#endif /* end of include guard: _RMQ_STATS_HH */
@@ -0,0 +1,505 @@
+////////////////////////////////////////////////////////////////////////////////
+// sharded_rmq.hpp
+//   Dynamic RMQ partitioned in independent AVL shards.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Massimiliano Rossi
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+/*!
+   \file sharded_rmq.hpp
+   \brief sharded_rmq.hpp Dynamic RMQ partitioned in independent AVL shards.
+   \author Massimiliano Rossi
+   \date 20/10/2021
+*/
+
+#ifndef _SHARDED_RMQ_HH
+#define _SHARDED_RMQ_HH
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <cstddef>
+#include <utility>
+#include <thread>
+#include <assert.h>
+#include "avl_rmq.hpp"
+
+/*!
+* Dynamic array supporting Range Minimum Queries, partitioned in consecutive
+* shards of similar size. Each shard is an avl_rmq with its own pool, so that
+* the batch operations process the shards in parallel, one thread per shard.
+* A small complete binary tree over the aggregates of the shards answers the
+* middle part of the queries spanning several shards. When a shard grows to
+* more than twice the average size, the shards are rebalanced by splitting and
+* joining the trees. The pieces moved between shards are first copied node by
+* node into a new pool by avl_rmq::compact, in time linear in their size, so
+* that no two shards share a pool; the other shards are not visited.
+* K is the type of the keys
+* S is the type of the values
+* Op is the aggregate maintained for each subtree, see rmq_ops.hpp
+*/
+template< typename K, typename S, typename Op = rmq_min<S> >
+class sharded_rmq{
+public:
+
+    typedef avl_rmq<K,S,Op> tree_t;
+    typedef typename Op::value_type agg_t;
+
+    /*!
+    * Costructor
+    * @param n_shards   the number of shards, by default the number of cores.
+    */
+    sharded_rmq(size_t n_shards = std::thread::hardware_concurrency()):
+        shards(std::max<size_t>(n_shards, 1)),
+        offsets(shards.size() + 1, 0),
+        leaves(1),
+        summary()
+    {
+        while(leaves < shards.size())
+            leaves *= 2;
+        summary.assign(2 * leaves, Op::identity());
+    }
+
+    sharded_rmq(const sharded_rmq&) = delete;
+    sharded_rmq& operator=(const sharded_rmq&) = delete;
+
+    /*!
+     * @return the number of shards.
+     */
+    inline size_t n_shards() const
+    {
+        return shards.size();
+    }
+
+    /*!
+     * @return the number of elements of the array.
+     */
+    inline K size() const
+    {
+        return offsets.back();
+    }
+
+    /*!
+     * @return the number of elements of the i-th shard.
+     */
+    inline K shard_size(size_t i) const
+    {
+        return offsets[i + 1] - offsets[i];
+    }
+
+    /*!
+     * Replace the content of the array with the range [first, last), building
+     * the shards in parallel.
+     * @param first  the random access iterator to the first element.
+     * @param last   the random access iterator past the last element.
+     */
+    template< typename It>
+    void build(It first, It last)
+    {
+        static_assert(std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<It>::iterator_category>::value,
+            "the parallel build requires random access iterators");
+        const size_t n = static_cast<size_t>(last - first);
+        const size_t p = shards.size();
+        std::vector<size_t> work(p);
+        for(size_t i = 0; i < p; ++i)
+            work[i] = i;
+        parallel(work, [this, first, n, p](size_t i)
+        {
+            shards[i].build(first + static_cast<std::ptrdiff_t>(n * i / p), first + static_cast<std::ptrdiff_t>(n * (i + 1) / p));
+        });
+        refresh();
+    }
+
+    /*!
+     * Access the array.
+     * @param rank  the rank of the element to be accessed.
+     */
+    S operator[](K rank)
+    {
+        if(rank >= size())
+            return 0;
+        const size_t i = find(rank);
+        return shards[i][rank - offsets[i]];
+    }
+
+    /*!
+     * Insert the value in the array with rank rank.
+     * @param rank  the rank of the element that has to be inserted.
+     * @param value the value information attached to the element.
+     */
+    void insert(K rank, S value)
+    {
+        if(rank > size())
+            rank = size();
+        const size_t i = find_insert(rank);
+        shards[i].insert(rank - offsets[i], value);
+        for(size_t j = i + 1; j < offsets.size(); ++j)
+            offsets[j]++;
+        set_summary(i);
+        if(shard_size(i) > max_shard_size())
+            rebalance();
+    }
+
+    /*!
+     * Update the value in the array with rank rank.
+     * @param rank  the rank of the element that has to be updated.
+     * @param value the value information attached to the element.
+     */
+    void update(K rank, S value)
+    {
+        if(rank >= size())
+            return;
+        const size_t i = find(rank);
+        shards[i].update(rank - offsets[i], value);
+        set_summary(i);
+    }
+
+    /*!
+     * Remove the element in the array with rank rank.
+     * @param rank  the rank of the element that has to be removed.
+     */
+    void erase(K rank)
+    {
+        if(rank >= size())
+            return;
+        const size_t i = find(rank);
+        shards[i].erase(rank - offsets[i]);
+        for(size_t j = i + 1; j < offsets.size(); ++j)
+            offsets[j]--;
+        set_summary(i);
+    }
+
+    /*!
+     * Insert a batch of m values, as avl_rmq::insert_batch. The batch is
+     * partitioned by shard, and the shards are updated in parallel.
+     * @param edits the pairs (rank, value) to be inserted, sorted by rank.
+     * @param m     the number of pairs.
+     */
+    void insert_batch(const std::pair<K,S>* edits, size_t m)
+    {
+        std::vector< std::vector< std::pair<K,S> > > local(shards.size());
+        for(size_t e = 0; e < m; ++e)
+        {
+            const K rank = std::min(edits[e].first, size());
+            const size_t i = find_insert(rank);
+            local[i].push_back(std::make_pair(rank - offsets[i], edits[e].second));
+        }
+        parallel(active(local), [this, &local](size_t i)
+        {
+            shards[i].insert_batch(local[i].data(), local[i].size());
+        });
+        refresh();
+        for(size_t i = 0; i < shards.size(); ++i)
+            if(shard_size(i) > max_shard_size())
+            {
+                rebalance();
+                break;
+            }
+    }
+
+    /*!
+     * Update a batch of m values, as avl_rmq::update_batch. The batch is
+     * partitioned by shard, and the shards are updated in parallel.
+     * @param edits the pairs (rank, value) to be updated, sorted by rank.
+     * @param m     the number of pairs.
+     */
+    void update_batch(const std::pair<K,S>* edits, size_t m)
+    {
+        std::vector< std::vector< std::pair<K,S> > > local(shards.size());
+        for(size_t e = 0; e < m; ++e)
+        {
+            if(edits[e].first >= size())
+                continue;
+            const size_t i = find(edits[e].first);
+            local[i].push_back(std::make_pair(edits[e].first - offsets[i], edits[e].second));
+        }
+        parallel(active(local), [this, &local](size_t i)
+        {
+            shards[i].update_batch(local[i].data(), local[i].size());
+        });
+        for(size_t i = 0; i < shards.size(); ++i)
+            if(not local[i].empty())
+                set_summary(i);
+    }
+
+    /*!
+     * Computes the aggregate of the interval [left, right), by default its
+     * minimum. The boundary shards are queried, and the shards in between are
+     * combined from their aggregates.
+     * @param left  the left boundary interval (includisve).
+     * @param right the right boundary of the interval (exclusive).
+     */
+    agg_t operator()(K left, K right)
+    {
+        if(right > size())
+            right = size();
+        if(left >= right)
+            return Op::identity();
+        const size_t l = find(left);
+        const size_t r = find(right - 1);
+        if(l == r)
+            return shards[l](left - offsets[l], right - offsets[l]);
+        agg_t agg = shards[l](left - offsets[l], shard_size(l));
+        agg = Op::combine(agg, middle(l + 1, r));
+        return Op::combine(agg, shards[r](0, right - offsets[r]));
+    }
+
+    /*!
+     * Computes the aggregates of a batch of m intervals. The parts of the
+     * intervals inside the boundary shards are answered in parallel, one
+     * thread per shard, by avl_rmq::query_batch.
+     * @param ranges the intervals [left, right).
+     * @param m      the number of intervals.
+     * @param out    the output array of m aggregates.
+     */
+    void query_batch(const std::pair<K,K>* ranges, size_t m, agg_t* out)
+    {
+        // The pieces of the queries in each shard, and where to store them.
+        std::vector< std::vector< std::pair<K,K> > > pieces(shards.size());
+        std::vector< std::vector<agg_t*> > targets(shards.size());
+        std::vector<agg_t> lefts(m, Op::identity());
+        std::vector<agg_t> rights(m, Op::identity());
+        for(size_t q = 0; q < m; ++q)
+        {
+            const K left = ranges[q].first;
+            const K right = std::min(ranges[q].second, size());
+            out[q] = Op::identity();
+            if(left >= right)
+                continue;
+            const size_t l = find(left);
+            const size_t r = find(right - 1);
+            if(l == r)
+            {
+                pieces[l].push_back(std::make_pair(left - offsets[l], right - offsets[l]));
+                targets[l].push_back(&lefts[q]);
+                continue;
+            }
+            pieces[l].push_back(std::make_pair(left - offsets[l], shard_size(l)));
+            targets[l].push_back(&lefts[q]);
+            pieces[r].push_back(std::make_pair(K(0), right - offsets[r]));
+            targets[r].push_back(&rights[q]);
+            out[q] = middle(l + 1, r);
+        }
+        parallel(active(pieces), [this, &pieces, &targets](size_t i)
+        {
+            std::vector<agg_t> res(pieces[i].size());
+            shards[i].query_batch(pieces[i].data(), pieces[i].size(), res.data());
+            for(size_t j = 0; j < res.size(); ++j)
+                *targets[i][j] = res[j];
+        });
+        for(size_t q = 0; q < m; ++q)
+            out[q] = Op::combine(Op::combine(lefts[q], out[q]), rights[q]);
+    }
+
+    /*!
+     * Rebalance the shards to sizes differing by at most one, moving the
+     * exceeding elements between consecutive shards.
+     */
+    void rebalance()
+    {
+        const size_t p = shards.size();
+        const size_t n = size();
+        for(size_t i = 0; i + 1 < p; ++i)
+        {
+            const K target = static_cast<K>(n * (i + 1) / p - n * i / p);
+            K curr = shards[i].size();
+            if(curr > target)
+            {
+                // Move the suffix to the front of the next shard.
+                std::pair<tree_t, tree_t> parts = shards[i].split(target);
+                tree_t moved = relocate(std::move(parts.second));
+                shards[i] = std::move(parts.first);
+                shards[i + 1] = tree_t::join(std::move(moved), std::move(shards[i + 1]));
+            }
+            for(size_t j = i + 1; curr < target and j < p; ++j)
+            {
+                // Move the prefix of the next non empty shards to the back.
+                const K count = std::min<K>(target - curr, shards[j].size());
+                if(count == 0)
+                    continue;
+                std::pair<tree_t, tree_t> parts = shards[j].split(count);
+                tree_t moved = relocate(std::move(parts.first));
+                shards[j] = std::move(parts.second);
+                shards[i] = tree_t::join(std::move(shards[i]), std::move(moved));
+                curr += count;
+            }
+        }
+        refresh();
+    }
+
+    /*!
+     * Converts the array into an std::vector, each shard writing its slice of
+     * the result in parallel.
+     */
+    std::vector<S> to_vector()
+    {
+        std::vector<S> res(size());
+        std::vector<size_t> work;
+        for(size_t i = 0; i < shards.size(); ++i)
+            if(shard_size(i) > 0)
+                work.push_back(i);
+        parallel(work, [this, &res](size_t i)
+        {
+            S* out = res.data() + offsets[i];
+            shards[i].for_each(0, shards[i].size(), [&out](const S& value){ *out++ = value; });
+        });
+        return res;
+    }
+
+    /*!
+     * Print the array.
+     */
+    void print()
+    {
+        std::vector<S> vec = to_vector();
+        for(size_t i = 0; i < vec.size(); ++i)
+            std::cout << vec[i] << " ";
+        std::cout << std::endl;
+    }
+
+  protected:
+
+    static const size_t min_rebalance = 1024; // Slack of the shard sizes before a rebalance.
+
+    /*!
+     * @return the largest size of a shard before a rebalance.
+     */
+    inline size_t max_shard_size() const
+    {
+        return 2 * (size() / shards.size()) + min_rebalance;
+    }
+
+    /*!
+     * @return the shard of the element with rank rank < size().
+     */
+    inline size_t find(K rank) const
+    {
+        return static_cast<size_t>(std::upper_bound(offsets.begin() + 1, offsets.end(), rank) - offsets.begin()) - 1;
+    }
+
+    /*!
+     * @return the shard where a value with rank rank is inserted, the last
+     * one if rank == size().
+     */
+    inline size_t find_insert(K rank) const
+    {
+        return rank < size() ? find(rank) : shards.size() - 1;
+    }
+
+    /*!
+     * Move the nodes of the tree into a new pool, so that the pools of the
+     * shards stay independent after the join. The nodes are copied without
+     * rebuilding the tree, and released from the shared pool.
+     */
+    static tree_t relocate(tree_t&& tree)
+    {
+        tree.compact();
+        return std::move(tree);
+    }
+
+    /*!
+     * Recomputes the offsets and the summary of all the shards.
+     */
+    void refresh()
+    {
+        for(size_t i = 0; i < shards.size(); ++i)
+            offsets[i + 1] = offsets[i] + shards[i].size();
+        for(size_t i = 0; i < shards.size(); ++i)
+            summary[leaves + i] = shards[i](0, shards[i].size());
+        for(size_t i = leaves - 1; i > 0; --i)
+            summary[i] = Op::combine(summary[2 * i], summary[2 * i + 1]);
+    }
+
+    /*!
+     * Recomputes the aggregate of the i-th shard in the summary.
+     */
+    void set_summary(size_t i)
+    {
+        i += leaves;
+        summary[i] = shards[i - leaves](0, shards[i - leaves].size());
+        for(i /= 2; i > 0; i /= 2)
+            summary[i] = Op::combine(summary[2 * i], summary[2 * i + 1]);
+    }
+
+    /*!
+     * @return the aggregate of the shards in [l, r).
+     */
+    agg_t middle(size_t l, size_t r) const
+    {
+        agg_t l_agg = Op::identity();
+        agg_t r_agg = Op::identity();
+        for(l += leaves, r += leaves; l < r; l /= 2, r /= 2)
+        {
+            if(l & 1)
+                l_agg = Op::combine(l_agg, summary[l++]);
+            if(r & 1)
+                r_agg = Op::combine(summary[--r], r_agg);
+        }
+        return Op::combine(l_agg, r_agg);
+    }
+
+    /*!
+     * @return the shards with a non empty list of work.
+     */
+    template< typename T>
+    static std::vector<size_t> active(const std::vector< std::vector<T> >& work)
+    {
+        std::vector<size_t> res;
+        for(size_t i = 0; i < work.size(); ++i)
+            if(not work[i].empty())
+                res.push_back(i);
+        return res;
+    }
+
+    /*!
+     * Calls f on each shard in work, each one in a different thread. The last
+     * shard is processed by the current thread.
+     */
+    template< typename F>
+    static void parallel(const std::vector<size_t>& work, F f)
+    {
+        if(work.empty())
+            return;
+        std::vector<std::thread> workers;
+        workers.reserve(work.size() - 1);
+        for(size_t j = 0; j + 1 < work.size(); ++j)
+            workers.emplace_back(f, work[j]);
+        f(work.back());
+        for(size_t j = 0; j < workers.size(); ++j)
+            workers[j].join();
+    }
+
+  private:
+    std::vector<tree_t> shards;     // The shards, in order.
+    std::vector<K> offsets;         // The rank of the first element of each shard, and the size.
+    size_t leaves;                  // The number of leaves of the summary.
+    std::vector<agg_t> summary;     // The complete binary tree over the aggregates of the shards.
+
+}; // sharded_rmq
+
+template< typename K, typename S, typename Op>
+const size_t sharded_rmq<K,S,Op>::min_rebalance;
+
+#endif /* end of include guard: _SHARDED_RMQ_HH */
@@ -0,0 +1,456 @@
+////////////////////////////////////////////////////////////////////////////////
+// sliding_window_rmq.hpp
+//   Double ended queue supporting Range Minimum Queries.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Massimiliano Rossi
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+/*!
+   \file sliding_window_rmq.hpp
+   \brief sliding_window_rmq.hpp Double ended queue supporting Range Minimum Queries.
+   \author Massimiliano Rossi
+   \date 20/10/2021
+*/
+
+#ifndef _SLIDING_WINDOW_RMQ_HH
+#define _SLIDING_WINDOW_RMQ_HH
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <assert.h>
+#include "rmq_ops.hpp"
+
+/*!
+* Stack of values supporting the aggregate of any interval. It stores the
+* aggregates of all the prefixes, hence the intervals starting at the bottom
+* are answered in constant time. The other intervals are answered in time
+* O(block log_block n) by a hierarchy of levels: level 0 stores the aggregates
+* of the complete blocks of block values, and level h + 1 stores the ones of 
+* the complete blocks of block entries of level h. Both push and pop take
+* constant amortized time.
+* If reversed is true, the values are combined from the top to the bottom of
+* the stack, i.e., the top of the stack comes first in the array.
+* S is the type of the values
+* Op is the aggregate, see rmq_ops.hpp
+*/
+template< typename S, typename Op, bool reversed>
+class window_stack{
+public:
+    typedef typename Op::value_type agg_t;
+
+    static const size_t block = 32; // Number of entries aggregated by each entry of the next level.
+
+    window_stack():
+        values(),
+        prefix(),
+        levels()
+    {
+
+    }
+
+    /*!
+     * @return the number of values of the stack.
+     */
+    inline size_t size() const
+    {
+        return values.size();
+    }
+
+    inline bool empty() const
+    {
+        return values.empty();
+    }
+
+    /*!
+     * @return the i-th value from the bottom of the stack.
+     */
+    inline const S& operator[](size_t i) const
+    {
+        return values[i];
+    }
+
+    /*!
+     * @return the aggregate of all the values.
+     */
+    inline agg_t all() const
+    {
+        return prefix.empty() ? Op::identity() : prefix.back();
+    }
+
+    /*!
+     * Push a value on the top of the stack.
+     */
+    void push(const S& value)
+    {
+        prefix.push_back(values.empty() ? Op::lift(value) : join(prefix.back(), Op::lift(value)));
+        values.push_back(value);
+
+        // Complete the blocks ending with the new value.
+        size_t n = values.size();
+        for(size_t h = 0; n % block == 0; ++h)
+        {
+            if(h == levels.size())
+                levels.push_back(std::vector<agg_t>());
+            levels[h].push_back(h == 0 ? scan_values(n - block, n) : scan_level(h - 1, n - block, n));
+            n = levels[h].size();
+        }
+    }
+
+    /*!
+     * Remove the value on the top of the stack, that must not be empty.
+     */
+    void pop()
+    {
+        assert(not values.empty());
+        // Drop the blocks ending with the removed value.
+        size_t n = values.size();
+        for(size_t h = 0; n % block == 0; ++h)
+        {
+            n = levels[h].size();
+            levels[h].pop_back();
+        }
+        values.pop_back();
+        prefix.pop_back();
+    }
+
+    /*!
+     * Remove all the values.
+     */
+    void clear()
+    {
+        values.clear();
+        prefix.clear();
+        levels.clear();
+    }
+
+    /*!
+     * Computes the aggregate of the values in positions [left, right) from 
+     * the bottom of the stack, with left < right <= size().
+     */
+    agg_t operator()(size_t left, size_t right) const
+    {
+        if(left == 0)
+            return prefix[right - 1];
+        return range(0, left, right);
+    }
+
+  protected:
+
+    /*!
+     * Combine the aggregates a and b, where a is below b in the stack.
+     */
+    static inline agg_t join(const agg_t& a, const agg_t& b)
+    {
+        return reversed ? Op::combine(b, a) : Op::combine(a, b);
+    }
+
+    /*!
+     * @return the aggregate of the values in [left, right).
+     */
+    inline agg_t scan_values(size_t left, size_t right) const
+    {
+        agg_t agg = Op::lift(values[left]);
+        for(size_t i = left + 1; i < right; ++i)
+            agg = join(agg, Op::lift(values[i]));
+        return agg;
+    }
+
+    /*!
+     * @return the aggregate of the entries in [left, right) of level h.
+     */
+    inline agg_t scan_level(size_t h, size_t left, size_t right) const
+    {
+        agg_t agg = levels[h][left];
+        for(size_t i = left + 1; i < right; ++i)
+            agg = join(agg, levels[h][i]);
+        return agg;
+    }
+
+    /*!
+     * @return the aggregate of the entries in [left, right) of the level
+     *         below h, where the level below 0 are the values.
+     */
+    inline agg_t scan(size_t h, size_t left, size_t right) const
+    {
+        return h == 0 ? scan_values(left, right) : scan_level(h - 1, left, right);
+    }
+
+    /*!
+     * Computes the aggregate of the entries [left, right) of the level below
+     * h, with left < right, scanning the partial blocks at the ends and
+     * answering the complete blocks from level h.
+     */
+    agg_t range(size_t h, size_t left, size_t right) const
+    {
+        const size_t first = (left + block - 1) / block;
+        const size_t last = right / block;
+        if(first >= last)
+            return scan(h, left, right);
+
+        agg_t agg = range(h + 1, first, last);
+        if(left < first * block)
+            agg = join(scan(h, left, first * block), agg);
+        if(last * block < right)
+            agg = join(agg, scan(h, last * block, right));
+        return agg;
+    }
+
+  private:
+    std::vector<S> values;                  // The values, from the bottom of the stack.
+    std::vector<agg_t> prefix;              // The aggregates of the prefixes.
+    std::vector< std::vector<agg_t> > levels; // The aggregates of the complete blocks.
+
+}; // window_stack
+
+template< typename S, typename Op, bool reversed>
+const size_t window_stack<S,Op,reversed>::block;
+
+/*!
+* Double ended queue supporting Range Minimum Queries, for the arrays that
+* grow at one end and shrink at the other, as sliding windows. The array is 
+* split in two stacks: the head stores the first elements with the first one
+* on top, and the tail stores the remaining ones with the last one on top. 
+* The insertions and deletions at both ends, and the access, take constant
+* amortized time. When the stack of one end is empty, the one of the other end
+* is split in half, so that alternating the two ends does not move the values
+* back and forth. The aggregate of the whole array, of its suffixes starting
+* in the head and of its prefixes ending in the tail take constant time,
+* while the other intervals take O(log n) time.
+* K is the type of the keys
+* S is the type of the values
+* Op is the aggregate, see rmq_ops.hpp
+*/
+template< typename K, typename S, typename Op = rmq_min<S> >
+class sliding_window_rmq{
+public:
+    typedef typename Op::value_type agg_t;
+
+    /*!
+    * Costructor
+    */
+    sliding_window_rmq():
+        head(),
+        tail()
+    {
+
+    }
+
+    /*!
+    * Costructor
+    * Builds the array from the range [first, last) in linear time.
+    * @param first  the iterator to the first element.
+    * @param last   the iterator past the last element.
+    */
+    template< typename It>
+    sliding_window_rmq(It first, It last):
+        head(),
+        tail()
+    {
+        build(first, last);
+    }
+
+    /*!
+     * Replace the content of the array with the range [first, last), in 
+     * linear time.
+     */
+    template< typename It>
+    void build(It first, It last)
+    {
+        clear();
+        for(; first != last; ++first)
+            tail.push(*first);
+    }
+
+    /*!
+     * Remove all the elements.
+     */
+    void clear()
+    {
+        head.clear();
+        tail.clear();
+    }
+
+    /*!
+     * @return the number of elements of the array.
+     */
+    inline K size() const
+    {
+        return static_cast<K>(head.size() + tail.size());
+    }
+
+    inline bool empty() const
+    {
+        return head.empty() and tail.empty();
+    }
+
+    /*!
+     * Access the array. 
+     * @param rank  the rank of the element to be accessed, smaller than size().
+     */
+    inline const S& operator[](K rank) const
+    {
+        const size_t r = static_cast<size_t>(rank);
+        return r < head.size() ? head[head.size() - 1 - r] : tail[r - head.size()];
+    }
+
+    /*!
+     * @return the first element of the array, that must not be empty.
+     */
+    inline const S& front() const
+    {
+        return head.empty() ? tail[0] : head[head.size() - 1];
+    }
+
+    /*!
+     * @return the last element of the array, that must not be empty.
+     */
+    inline const S& back() const
+    {
+        return tail.empty() ? head[0] : tail[tail.size() - 1];
+    }
+
+    /*!
+     * Append the value at the end of the array.
+     */
+    inline void push_back(const S& value)
+    {
+        tail.push(value);
+    }
+
+    /*!
+     * Insert the value at the beginning of the array.
+     */
+    inline void push_front(const S& value)
+    {
+        head.push(value);
+    }
+
+    /*!
+     * Remove the first element of the array. Does nothing if it is empty.
+     */
+    void pop_front()
+    {
+        if(head.empty())
+        {
+            if(tail.empty())
+                return;
+            refill(tail, head);
+        }
+        head.pop();
+    }
+
+    /*!
+     * Remove the last element of the array. Does nothing if it is empty.
+     */
+    void pop_back()
+    {
+        if(tail.empty())
+        {
+            if(head.empty())
+                return;
+            refill(head, tail);
+        }
+        tail.pop();
+    }
+
+    /*!
+     * Computes the aggregate of the interval [left, right), by default its 
+     * minimum.
+     * @param left  the left boundary interval (includisve).
+     * @param right the right boundary of the interval (exclusive).
+     */
+    agg_t operator ()(K left, K right) const
+    {
+        const size_t n = head.size() + tail.size();
+        size_t l = static_cast<size_t>(left);
+        size_t r = std::min(static_cast<size_t>(right), n);
+        if(l >= r)
+            return Op::identity();
+
+        // In the head, the ranks [l, r) are the positions [h - r, h - l).
+        const size_t h = head.size();
+        agg_t agg = Op::identity();
+        if(l < h)
+            agg = head(h - std::min(r, h), h - l);
+        if(r > h)
+            agg = Op::combine(agg, tail(l > h ? l - h : 0, r - h));
+        return agg;
+    }
+
+    /*!
+     * Converts the array into an std::vector.
+     */
+    std::vector<S> to_vector() const
+    {
+        std::vector<S> res;
+        res.reserve(head.size() + tail.size());
+        for(size_t i = head.size(); i > 0; --i)
+            res.push_back(head[i - 1]);
+        for(size_t i = 0; i < tail.size(); ++i)
+            res.push_back(tail[i]);
+        return res;
+    }
+
+    /*!
+     * Print the array.
+     */
+    void print() const
+    {
+        for(size_t i = head.size(); i > 0; --i)
+            std::cout << head[i - 1] << " ";
+        for(size_t i = 0; i < tail.size(); ++i)
+            std::cout << tail[i] << " ";
+        std::cout << std::endl;
+    }
+
+  protected:
+
+    /*!
+     * Move the half of the values of src closer to the bottom into the empty
+     * stack dst, so that the bottom of src becomes the top of dst.
+     */
+    template< typename Src, typename Dst>
+    static void refill(Src& src, Dst& dst)
+    {
+        const size_t n = src.size();
+        const size_t moved = (n + 1) / 2;
+        std::vector<S> values(n);
+        for(size_t i = 0; i < n; ++i)
+            values[i] = src[i];
+        for(size_t i = moved; i > 0; --i)
+            dst.push(values[i - 1]);
+        src.clear();
+        for(size_t i = moved; i < n; ++i)
+            src.push(values[i]);
+    }
+
+  private:
+    window_stack<S, Op, true> head;  // The first elements, the first one on top.
+    window_stack<S, Op, false> tail; // The last elements, the last one on top.
+
+}; // sliding_window_rmq
+
+#endif /* end of include guard: _SLIDING_WINDOW_RMQ_HH */
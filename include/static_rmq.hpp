@@ -0,0 +1,188 @@
+////////////////////////////////////////////////////////////////////////////////
+// static_rmq.hpp
+//   Static RMQ index over a snapshot of the array.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Massimiliano Rossi
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+/*!
+   \file static_rmq.hpp
+   \brief static_rmq.hpp Static RMQ index over a snapshot of the array.
+   \author Massimiliano Rossi
+   \date 20/10/2021
+*/
+
+#ifndef _STATIC_RMQ_HH
+#define _STATIC_RMQ_HH
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include "rmq_ops.hpp"
+
+/*!
+* Static array supporting Range Minimum Queries in constant time, used by
+* avl_rmq::freeze during the read-only phases.
+* The values are stored contiguously and grouped in blocks of block values. A
+* disjoint sparse table over the aggregates of the blocks stores, for each
+* level h and each block i, the aggregate from i to the middle of the segment
+* of 2^h blocks containing i. The blocks spanned by a query are covered by two
+* entries of the same level, and the two partial blocks at its ends are
+* scanned. Unlike the classic sparse table, the entries do not overlap, hence
+* the index supports any aggregate, not only the idempotent ones as the
+* minimum. The index uses about (n / block) log(n / block) aggregates.
+* K is the type of the keys
+* S is the type of the values
+* Op is the aggregate, see rmq_ops.hpp
+*/
+template< typename K, typename S, typename Op = rmq_min<S> >
+class static_rmq{
+public:
+    typedef typename Op::value_type agg_t;
+
+    static const size_t block = 32; // Number of values of each block.
+
+    /*!
+    * Costructor
+    * @param vec  the array, moved into the index.
+    */
+    static_rmq(std::vector<S>&& vec):
+        values(std::move(vec)),
+        width(1),
+        levels(1),
+        table()
+    {
+        const size_t n_blocks = (values.size() + block - 1) / block;
+        while(width < n_blocks)
+        {
+            width *= 2;
+            levels++;
+        }
+        table.assign(levels * width, Op::identity());
+
+        // Level 0 stores the aggregates of the blocks.
+        for(size_t i = 0; i < values.size(); ++i)
+            table[i / block] = Op::combine(table[i / block], Op::lift(values[i]));
+
+        for(size_t h = 1; h < levels; ++h)
+        {
+            agg_t* level = &table[h * width];
+            const size_t half = size_t(1) << (h - 1);
+            for(size_t mid = half; mid < width; mid += 2 * half)
+            {
+                // Suffixes of the left half and prefixes of the right half.
+                level[mid - 1] = table[mid - 1];
+                for(size_t i = mid - 1; i > mid - half; --i)
+                    level[i - 1] = Op::combine(table[i - 1], level[i]);
+                level[mid] = table[mid];
+                for(size_t i = mid + 1; i < mid + half; ++i)
+                    level[i] = Op::combine(level[i - 1], table[i]);
+            }
+        }
+    }
+
+    /*!
+     * @return the number of elements of the array.
+     */
+    inline size_t size() const
+    {
+        return values.size();
+    }
+
+    /*!
+     * @return the memory used by the index, in bytes.
+     */
+    inline size_t memory_usage() const
+    {
+        return values.capacity() * sizeof(S) + table.capacity() * sizeof(agg_t);
+    }
+
+    /*!
+     * Access the array.
+     * @param rank  the rank of the element to be accessed, smaller than size().
+     */
+    inline const S& operator[](K rank) const
+    {
+        return values[static_cast<size_t>(rank)];
+    }
+
+    /*!
+     * Computes the aggregate of the interval [left, right), with
+     * left < right <= size().
+     * @param left  the left boundary interval (includisve).
+     * @param right the right boundary of the interval (exclusive).
+     */
+    agg_t operator()(K left, K right) const
+    {
+        const size_t l = static_cast<size_t>(left);
+        const size_t r = static_cast<size_t>(right);
+        const size_t l_block = l / block;
+        const size_t r_block = (r - 1) / block;
+        if(l_block == r_block)
+            return scan(l, r);
+
+        agg_t agg = scan(l, (l_block + 1) * block);
+        if(l_block + 1 < r_block)
+            agg = Op::combine(agg, blocks(l_block + 1, r_block - 1));
+        return Op::combine(agg, scan(r_block * block, r));
+    }
+
+  protected:
+
+    /*!
+     * @return the aggregate of the blocks in [first, last].
+     */
+    inline agg_t blocks(size_t first, size_t last) const
+    {
+        if(first == last)
+            return table[first];
+        // The level of the smallest segment containing both blocks.
+        const size_t h = 64 - static_cast<size_t>(__builtin_clzll(static_cast<unsigned long long>(first ^ last)));
+        return Op::combine(table[h * width + first], table[h * width + last]);
+    }
+
+    /*!
+     * @return the aggregate of the values in [left, right).
+     */
+    inline agg_t scan(size_t left, size_t right) const
+    {
+        agg_t agg = Op::identity();
+        for(size_t i = left; i < right; ++i)
+            agg = Op::combine(agg, Op::lift(values[i]));
+        return agg;
+    }
+
+  private:
+    std::vector<S> values;      // The values of the array.
+    size_t width;               // The number of blocks, rounded to a power of two.
+    size_t levels;              // The number of levels of the table.
+    std::vector<agg_t> table;   // The levels of the disjoint sparse table.
+
+}; // static_rmq
+
+template< typename K, typename S, typename Op>
+const size_t static_rmq<K,S,Op>::block;
+
+#endif /* end of include guard: _STATIC_RMQ_HH */
@@ -0,0 +1,76 @@
+////////////////////////////////////////////////////////////////////////////////
+// async_rmq_test.cpp
+//   Test the rmq write-behind queue.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Massimiliano Rossi
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+/*!
+   \file async_rmq_test.cpp
+   \brief async_rmq_test.cpp Test the rmq write-behind queue.
+   \author Massimiliano Rossi
+   \date 20/10/2021
+*/
+
+#include <iostream>
+#include <thread>
+#include <async_rmq.hpp>
+#include <malloc_count.h>
+
+int main(int argc, char *const argv[])
+{
+
+    int freq[] = {2, 1, 1, 3, 2, 3, 4, 5, 6, 7, 8, 9};
+    int n = sizeof(freq)/sizeof(freq[0]);
+
+    async_rmq<uint32_t,int> rmq;
+    uint64_t seq = 0;
+    for(int i = 0; i < n; ++i)
+        seq = rmq.insert(static_cast<uint32_t>(i), freq[i]);
+
+    rmq.wait(seq);
+    std::cout << "Applied " << rmq.last_applied() << " edits" << std::endl; // 12
+    std::cout << "Min in arr[1..3) is " << rmq(1,3) << std::endl; // 1
+    std::cout << "Min in arr[3..7) is " << rmq(3,7) << std::endl; // 2
+
+    seq = rmq.update(1, 7);
+    std::cout << "Min in arr[1..3) is " << rmq.query(seq,1,3) << std::endl; // 1
+
+    // Two writers inserting at the front concurrently.
+    std::thread writer([&rmq]() {
+        for(int i = 0; i < 100; ++i)
+            rmq.insert(0, 10 + i);
+    });
+    for(int i = 0; i < 100; ++i)
+        rmq.insert(0, 20 + i);
+    writer.join();
+
+    rmq.flush();
+    std::cout << "Size is " << rmq.size() << std::endl; // 212
+    std::cout << "Min of the array is " << rmq(0,rmq.size()) << std::endl; // 1
+    std::cout << "Min in arr[0..200) is " << rmq(0,200) << std::endl; // 10
+    std::cout << "Value at arr[201] is " << rmq[201] << std::endl; // 7
+
+    return 0;
+}
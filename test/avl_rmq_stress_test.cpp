@@ -0,0 +1,996 @@
+////////////////////////////////////////////////////////////////////////////////
+// avl_rmq_stress_test.cpp
+//   Randomized comparison of the rmq structures against a plain array.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Massimiliano Rossi
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+/*!
+   \file avl_rmq_stress_test.cpp
+   \brief avl_rmq_stress_test.cpp Randomized comparison of the rmq structures against a plain array.
+   \author Massimiliano Rossi
+   \date 20/10/2021
+*/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdio>
+#include <vector>
+#include <deque>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+#include <avl_rmq.hpp>
+#include <compact_avl_rmq.hpp>
+#include <btree_rmq.hpp>
+#include <bucket_avl_rmq.hpp>
+#include <sharded_rmq.hpp>
+#include <persistent_avl_rmq.hpp>
+#include <concurrent_avl_rmq.hpp>
+#include <sliding_window_rmq.hpp>
+#include <async_rmq.hpp>
+#include <mapped_rmq.hpp>
+
+// Usage: avl_rmq_stress_test [seed] [steps]
+// Applies random operations both to each rmq structure and to a std::vector,
+// and compares the answers of the structure with the naive ones. Each 
+// structure has its own run, seeded with the same seed. The invariants of
+// avl_rmq are checked with check_integrity() every check_every steps, while
+// the other structures are compared with the array. The first mismatch is
+// reported with the structure, the seed and the step, and the test fails. The
+// checks do not rely on assert, so that the Release builds are checked as
+// well.
+
+static const size_t check_every = 64;
+static const size_t max_size = 4096;
+static const int max_value = 1000;
+
+typedef std::mt19937_64 gen_t;
+
+typedef avl_rmq<uint32_t,int> min_tree;
+typedef rmq_lazy<rmq_fuse<rmq_min<int>, rmq_sum<int,long> > > lazy_op;
+typedef avl_rmq<uint32_t,int,lazy_op> lazy_tree;
+
+/*!
+ * Polynomial hash of the values modulo 2^64, an aggregate that is associative
+ * but not commutative, so that the pieces of a query must be combined in
+ * order. The aggregate stores the hash and the power of the base.
+ */
+struct hash_op{
+    typedef std::pair<uint64_t,uint64_t> value_type;
+
+    static inline value_type identity() { return value_type(0, 1); }
+    static inline value_type lift(const int& v) { return value_type(static_cast<uint64_t>(v) + 1, 1000003); }
+    static inline value_type combine(const value_type& a, const value_type& b)
+    {
+        return value_type(a.first * b.second + b.first, a.second * b.second);
+    }
+};
+
+/*!
+ * The state of a run, used to report the mismatches.
+ */
+typedef struct run_t{
+    uint64_t seed;  // The seed of the run.
+    const char* name; // The tree under test.
+    size_t step;    // The current step.
+
+    /*!
+     * Report a mismatch, if ok is false.
+     * @return ok.
+     */
+    bool check(bool ok, const char* what) const
+    {
+        if(not ok)
+            std::cerr << name << ": mismatch in " << what << " with seed " << seed << " at step " << step << std::endl;
+        return ok;
+    }
+}run_t;
+
+/*!
+ * The naive aggregate of vec[left, right).
+ */
+template< typename Op>
+static typename Op::value_type naive(const std::vector<int>& vec, size_t left, size_t right)
+{
+    typename Op::value_type agg = Op::identity();
+    for(size_t i = left; i < right; ++i)
+        agg = Op::combine(agg, Op::lift(vec[i]));
+    return agg;
+}
+
+/*!
+ * A random interval [left, right) of an array of size n, possibly empty.
+ */
+static std::pair<uint32_t,uint32_t> random_range(gen_t& gen, size_t n)
+{
+    const size_t left = gen() % (n + 1);
+    const size_t right = left + gen() % (n - left + 1);
+    return std::make_pair(static_cast<uint32_t>(left), static_cast<uint32_t>(right));
+}
+
+/*!
+ * A random edit of an array of size n.
+ */
+static std::pair<uint32_t,int> random_edit(gen_t& gen, size_t n)
+{
+    return std::make_pair(static_cast<uint32_t>(gen() % n), static_cast<int>(gen() % max_value));
+}
+
+/*!
+ * Apply a random operation supported by any aggregate Op.
+ * @return false on a mismatch.
+ */
+template< typename Op, typename T>
+static bool common_step(T& rmq, std::vector<int>& vec, gen_t& gen, const run_t& run)
+{
+    typedef typename Op::value_type agg_t;
+    const size_t n = vec.size();
+    const int value = static_cast<int>(gen() % max_value);
+
+    switch(gen() % 16)
+    {
+    case 0:
+    case 1:
+    case 2:
+    {
+        // Insertions are more frequent while the array is small.
+        if(n >= max_size)
+            break;
+        const uint32_t rank = static_cast<uint32_t>(gen() % (n + 1));
+        rmq.insert(rank, value);
+        vec.insert(vec.begin() + rank, value);
+        break;
+    }
+    case 3:
+    {
+        if(n == 0)
+            break;
+        const uint32_t rank = static_cast<uint32_t>(gen() % n);
+        rmq.update(rank, value);
+        vec[rank] = value;
+        break;
+    }
+    case 4:
+    {
+        if(n == 0)
+            break;
+        const uint32_t rank = static_cast<uint32_t>(gen() % n);
+        rmq.erase(rank);
+        vec.erase(vec.begin() + rank);
+        break;
+    }
+    case 5:
+    {
+        const std::pair<uint32_t,uint32_t> range = random_range(gen, n);
+        // Keep the removed intervals short, so that the array does not vanish.
+        const uint32_t right = std::min<uint32_t>(range.second, range.first + 16);
+        rmq.erase(range.first, right);
+        vec.erase(vec.begin() + range.first, vec.begin() + right);
+        break;
+    }
+    case 6:
+    case 7:
+    case 8:
+    {
+        const std::pair<uint32_t,uint32_t> range = random_range(gen, n);
+        if(not run.check(rmq(range.first, range.second) == naive<Op>(vec, range.first, range.second), "operator()"))
+            return false;
+        break;
+    }
+    case 9:
+    {
+        if(n == 0)
+            break;
+        const uint32_t rank = static_cast<uint32_t>(gen() % n);
+        if(not run.check(rmq[rank] == vec[rank], "operator[]"))
+            return false;
+        break;
+    }
+    case 10:
+    {
+        // Sorted batch of insertions, the ranks refer to the array before them.
+        const size_t m = gen() % 32;
+        if(n + m > max_size)
+            break;
+        std::vector< std::pair<uint32_t,int> > edits(m);
+        for(size_t i = 0; i < m; ++i)
+            edits[i] = std::make_pair(static_cast<uint32_t>(gen() % (n + 1)), static_cast<int>(gen() % max_value));
+        std::stable_sort(edits.begin(), edits.end(), [](const std::pair<uint32_t,int>& a, const std::pair<uint32_t,int>& b) { return a.first < b.first; });
+        rmq.insert_batch(edits.data(), m);
+        for(size_t i = m; i > 0; --i)
+            vec.insert(vec.begin() + edits[i - 1].first, edits[i - 1].second);
+        break;
+    }
+    case 11:
+    {
+        // Sorted batch of updates, the last value of a repeated rank is kept.
+        if(n == 0)
+            break;
+        const size_t m = gen() % 32;
+        std::vector< std::pair<uint32_t,int> > edits(m);
+        for(size_t i = 0; i < m; ++i)
+            edits[i] = random_edit(gen, n);
+        std::stable_sort(edits.begin(), edits.end(), [](const std::pair<uint32_t,int>& a, const std::pair<uint32_t,int>& b) { return a.first < b.first; });
+        rmq.update_batch(edits.data(), m);
+        for(size_t i = 0; i < m; ++i)
+            vec[edits[i].first] = edits[i].second;
+        break;
+    }
+    case 12:
+    {
+        const size_t m = gen() % 64;
+        std::vector< std::pair<uint32_t,uint32_t> > ranges(m);
+        for(size_t i = 0; i < m; ++i)
+            ranges[i] = random_range(gen, n);
+        std::vector<agg_t> out(m);
+        rmq.query_batch(ranges.data(), m, out.data());
+        for(size_t i = 0; i < m; ++i)
+            if(not run.check(out[i] == naive<Op>(vec, ranges[i].first, ranges[i].second), "query_batch"))
+                return false;
+        break;
+    }
+    case 13:
+    {
+        const uint32_t rank = static_cast<uint32_t>(gen() % (n + 1));
+        std::pair<T,T> halves = rmq.split(rank);
+        if(not run.check(halves.first.size() == rank and halves.second.size() == n - rank, "split"))
+            return false;
+        if(not run.check(halves.first.check_integrity() and halves.second.check_integrity(), "split integrity"))
+            return false;
+        rmq = T::join(std::move(halves.first), std::move(halves.second));
+        break;
+    }
+    case 14:
+    {
+        // Switch between the layouts and the descents of the queries.
+        switch(gen() % 4)
+        {
+        case 0:
+            rmq.freeze();
+            break;
+        case 1:
+            rmq.compact();
+            break;
+        case 2:
+            rmq.set_prefetch(not rmq.is_prefetching());
+            break;
+        default:
+            rmq.build(vec.begin(), vec.end(), 1 + gen() % 4);
+            break;
+        }
+        break;
+    }
+    case 15:
+    {
+        // Scans of a window, forward and backward from a random position.
+        const std::pair<uint32_t,uint32_t> range = random_range(gen, n);
+        std::vector<int> window;
+        rmq.for_each(range.first, range.second, [&window](const int& v) { window.push_back(v); });
+        if(not run.check(window == std::vector<int>(vec.begin() + range.first, vec.begin() + range.second), "for_each"))
+            return false;
+        typename T::iterator it = rmq.iterator_at(range.first);
+        for(size_t i = range.first; i < range.second; ++i, ++it)
+            if(not run.check(it.rank() == i and *it == vec[i], "iterator"))
+                return false;
+        if(not run.check(it == rmq.iterator_at(range.second), "iterator end"))
+            return false;
+        for(size_t i = range.second; i > range.first; --i)
+            if(not run.check(*(--it) == vec[i - 1], "reverse iterator"))
+                return false;
+        break;
+    }
+    default:
+        break;
+    }
+    return true;
+}
+
+/*!
+ * Apply a random selection query of rmq_min.
+ * @return false on a mismatch.
+ */
+static bool selection_step(min_tree& rmq, const std::vector<int>& vec, gen_t& gen, const run_t& run)
+{
+    const size_t n = vec.size();
+    const std::pair<uint32_t,uint32_t> range = random_range(gen, n);
+    const int threshold = static_cast<int>(gen() % max_value);
+
+    // The leftmost minimum.
+    size_t pos = n;
+    for(size_t i = range.first; i < range.second; ++i)
+        if(pos == n or vec[i] < vec[pos])
+            pos = i;
+    const std::pair<int,uint32_t> res = rmq.min_with_pos(range.first, range.second);
+    if(not run.check(res.second == pos and (pos == n or res.first == vec[pos]), "min_with_pos"))
+        return false;
+
+    size_t first = range.first;
+    while(first < n and vec[first] >= threshold)
+        ++first;
+    if(not run.check(rmq.find_first_below(range.first, threshold) == std::min(first, n), "find_first_below"))
+        return false;
+
+    if(n > 0)
+    {
+        const size_t end = std::min<size_t>(range.second, n - 1);
+        size_t last = n;
+        for(size_t i = end + 1; i > 0; --i)
+            if(vec[i - 1] < threshold)
+            {
+                last = i - 1;
+                break;
+            }
+        if(not run.check(rmq.find_last_below(static_cast<uint32_t>(end), threshold) == last, "find_last_below"))
+            return false;
+    }
+    return true;
+}
+
+/*!
+ * Apply a random range update of the lazy aggregate.
+ */
+static void range_step(lazy_tree& rmq, std::vector<int>& vec, gen_t& gen)
+{
+    const std::pair<uint32_t,uint32_t> range = random_range(gen, vec.size());
+    if(gen() % 2 == 0)
+    {
+        const int delta = static_cast<int>(gen() % 7) - 3;
+        rmq.range_add(range.first, range.second, delta);
+        for(size_t i = range.first; i < range.second; ++i)
+            vec[i] += delta;
+    }
+    else
+    {
+        const int value = static_cast<int>(gen() % max_value);
+        rmq.range_assign(range.first, range.second, value);
+        for(size_t i = range.first; i < range.second; ++i)
+            vec[i] = value;
+    }
+}
+
+/*!
+ * Check the invariants and the content of the tree.
+ * @return false on a mismatch.
+ */
+template< typename T>
+static bool full_check(T& rmq, const std::vector<int>& vec, const run_t& run)
+{
+    return run.check(rmq.check_integrity(), "check_integrity") and
+           run.check(rmq.size() == vec.size(), "size") and
+           run.check(rmq.to_vector() == vec, "to_vector");
+}
+
+/*!
+ * Compare the content of a structure without check_integrity with the array.
+ * @return false on a mismatch.
+ */
+template< typename T>
+static bool content_check(T& rmq, const std::vector<int>& vec, const run_t& run)
+{
+    return run.check(rmq.size() == vec.size(), "size") and
+           run.check(rmq.to_vector() == vec, "to_vector");
+}
+
+template< typename T>
+static void erase_rank(T& rmq, std::vector<int>& vec, uint32_t rank, std::true_type)
+{
+    rmq.erase(rank);
+    vec.erase(vec.begin() + rank);
+}
+
+template< typename T>
+static void erase_rank(T&, std::vector<int>&, uint32_t, std::false_type) { }
+
+/*!
+ * Apply a random insertion, update, deletion if erase holds, minimum query or
+ * access, the interface shared by the range minimum structures.
+ * @return false on a mismatch.
+ */
+template< bool erase, typename T>
+static bool basic_step(T& rmq, std::vector<int>& vec, gen_t& gen, const run_t& run)
+{
+    const size_t n = vec.size();
+    const int value = static_cast<int>(gen() % max_value);
+
+    switch(gen() % 8)
+    {
+    case 0:
+    case 1:
+    {
+        if(n >= max_size)
+            break;
+        const uint32_t rank = static_cast<uint32_t>(gen() % (n + 1));
+        rmq.insert(rank, value);
+        vec.insert(vec.begin() + rank, value);
+        break;
+    }
+    case 2:
+    {
+        if(n == 0)
+            break;
+        const uint32_t rank = static_cast<uint32_t>(gen() % n);
+        rmq.update(rank, value);
+        vec[rank] = value;
+        break;
+    }
+    case 3:
+    {
+        if(n == 0)
+            break;
+        erase_rank(rmq, vec, static_cast<uint32_t>(gen() % n), std::integral_constant<bool, erase>());
+        break;
+    }
+    case 4:
+    case 5:
+    case 6:
+    {
+        const std::pair<uint32_t,uint32_t> range = random_range(gen, n);
+        if(not run.check(rmq(range.first, range.second) == naive<rmq_min<int> >(vec, range.first, range.second), "operator()"))
+            return false;
+        break;
+    }
+    default:
+    {
+        if(n == 0)
+            break;
+        const uint32_t rank = static_cast<uint32_t>(gen() % n);
+        if(not run.check(rmq[rank] == vec[rank], "operator[]"))
+            return false;
+        break;
+    }
+    }
+    return true;
+}
+
+/*!
+ * Random operations on a structure with the basic interface.
+ * @return false on a mismatch.
+ */
+template< bool erase, typename T>
+static bool run_basic(T& rmq, const char* name, uint64_t seed, size_t steps)
+{
+    gen_t gen(seed);
+    run_t run = {seed, name, 0};
+    std::vector<int> vec;
+    for(; run.step < steps; ++run.step)
+    {
+        if(not basic_step<erase>(rmq, vec, gen, run))
+            return false;
+        if(run.step % check_every == 0 and not content_check(rmq, vec, run))
+            return false;
+    }
+    return content_check(rmq, vec, run);
+}
+
+/*!
+ * Random operations on avl_rmq with rmq_min, including the selection queries.
+ * @return false on a mismatch.
+ */
+static bool run_avl(uint64_t seed, size_t steps)
+{
+    gen_t gen(seed);
+    run_t run = {seed, "avl_rmq", 0};
+    min_tree rmq;
+    std::vector<int> vec;
+    for(; run.step < steps; ++run.step)
+    {
+        if(not common_step<rmq_min<int> >(rmq, vec, gen, run))
+            return false;
+        if(gen() % 4 == 0 and not selection_step(rmq, vec, gen, run))
+            return false;
+        if(run.step % check_every == 0 and not full_check(rmq, vec, run))
+            return false;
+    }
+    return full_check(rmq, vec, run);
+}
+
+/*!
+ * Random operations on avl_rmq with a lazy aggregate, including the range
+ * updates.
+ * @return false on a mismatch.
+ */
+static bool run_lazy(uint64_t seed, size_t steps)
+{
+    gen_t gen(seed);
+    run_t run = {seed, "lazy avl_rmq", 0};
+    lazy_tree rmq;
+    std::vector<int> vec;
+    for(; run.step < steps; ++run.step)
+    {
+        if(not common_step<lazy_op>(rmq, vec, gen, run))
+            return false;
+        if(gen() % 4 == 0)
+            range_step(rmq, vec, gen);
+        if(run.step % check_every == 0 and not full_check(rmq, vec, run))
+            return false;
+    }
+    return full_check(rmq, vec, run);
+}
+
+/*!
+ * Random operations on sharded_rmq: the basic operations, the batches, that
+ * update the shards in parallel, and explicit rebalances and builds. After a
+ * rebalance the sizes of the shards differ by at most one.
+ * @return false on a mismatch.
+ */
+static bool run_sharded(uint64_t seed, size_t steps)
+{
+    gen_t gen(seed);
+    run_t run = {seed, "sharded_rmq", 0};
+    sharded_rmq<uint32_t,int> rmq(4);
+    std::vector<int> vec;
+    const auto by_rank = [](const std::pair<uint32_t,int>& a, const std::pair<uint32_t,int>& b) { return a.first < b.first; };
+    for(; run.step < steps; ++run.step)
+    {
+        const size_t n = vec.size();
+        switch(gen() % 16)
+        {
+        case 0:
+        {
+            const size_t m = gen() % 64;
+            if(n + m > max_size)
+                break;
+            std::vector< std::pair<uint32_t,int> > edits(m);
+            for(size_t i = 0; i < m; ++i)
+                edits[i] = std::make_pair(static_cast<uint32_t>(gen() % (n + 1)), static_cast<int>(gen() % max_value));
+            std::stable_sort(edits.begin(), edits.end(), by_rank);
+            rmq.insert_batch(edits.data(), m);
+            for(size_t i = m; i > 0; --i)
+                vec.insert(vec.begin() + edits[i - 1].first, edits[i - 1].second);
+            break;
+        }
+        case 1:
+        {
+            if(n == 0)
+                break;
+            const size_t m = gen() % 64;
+            std::vector< std::pair<uint32_t,int> > edits(m);
+            for(size_t i = 0; i < m; ++i)
+                edits[i] = random_edit(gen, n);
+            std::stable_sort(edits.begin(), edits.end(), by_rank);
+            rmq.update_batch(edits.data(), m);
+            for(size_t i = 0; i < m; ++i)
+                vec[edits[i].first] = edits[i].second;
+            break;
+        }
+        case 2:
+        {
+            const size_t m = gen() % 64;
+            std::vector< std::pair<uint32_t,uint32_t> > ranges(m);
+            for(size_t i = 0; i < m; ++i)
+                ranges[i] = random_range(gen, n);
+            std::vector<int> out(m);
+            rmq.query_batch(ranges.data(), m, out.data());
+            for(size_t i = 0; i < m; ++i)
+                if(not run.check(out[i] == naive<rmq_min<int> >(vec, ranges[i].first, ranges[i].second), "query_batch"))
+                    return false;
+            break;
+        }
+        case 3:
+        {
+            if(gen() % 8 == 0)
+                rmq.build(vec.begin(), vec.end());
+            else
+            {
+                rmq.rebalance();
+                uint32_t smallest = rmq.shard_size(0), largest = rmq.shard_size(0);
+                for(size_t i = 1; i < rmq.n_shards(); ++i)
+                {
+                    smallest = std::min(smallest, rmq.shard_size(i));
+                    largest = std::max(largest, rmq.shard_size(i));
+                }
+                if(not run.check(largest - smallest <= 1, "rebalance"))
+                    return false;
+            }
+            break;
+        }
+        default:
+            if(not basic_step<true>(rmq, vec, gen, run))
+                return false;
+            break;
+        }
+        if(run.step % check_every == 0 and not content_check(rmq, vec, run))
+            return false;
+    }
+    return content_check(rmq, vec, run);
+}
+
+/*!
+ * Random edits of the last version of persistent_avl_rmq, and queries of the
+ * versions kept alive, compared with a copy of the array for each of them.
+ * The versions are released both explicitly and by the window of the last
+ * keep versions.
+ * @return false on a mismatch.
+ */
+static bool run_persistent(uint64_t seed, size_t steps)
+{
+    typedef persistent_avl_rmq<uint32_t,int> tree_t;
+    static const size_t keep = 64;
+    gen_t gen(seed);
+    run_t run = {seed, "persistent_avl_rmq", 0};
+    tree_t rmq(keep);
+    std::deque< std::pair<tree_t::version_t, std::vector<int> > > history(1, std::make_pair(rmq.latest(), std::vector<int>()));
+    for(; run.step < steps; ++run.step)
+    {
+        std::vector<int> vec = history.back().second;
+        const size_t n = vec.size();
+        const int value = static_cast<int>(gen() % max_value);
+        bool edited = false;
+        switch(gen() % 8)
+        {
+        case 0:
+        case 1:
+        {
+            if(n >= max_size)
+                break;
+            const uint32_t rank = static_cast<uint32_t>(gen() % (n + 1));
+            rmq.insert(rank, value);
+            vec.insert(vec.begin() + rank, value);
+            edited = true;
+            break;
+        }
+        case 2:
+        {
+            if(n == 0)
+                break;
+            const uint32_t rank = static_cast<uint32_t>(gen() % n);
+            rmq.update(rank, value);
+            vec[rank] = value;
+            edited = true;
+            break;
+        }
+        case 3:
+        {
+            if(n == 0)
+                break;
+            const uint32_t rank = static_cast<uint32_t>(gen() % n);
+            rmq.erase(rank);
+            vec.erase(vec.begin() + rank);
+            edited = true;
+            break;
+        }
+        case 4:
+        {
+            // Release an old version, the last one can not be released.
+            if(history.size() < 2 or gen() % 4 != 0)
+                break;
+            const size_t i = gen() % (history.size() - 1);
+            rmq.release(history[i].first);
+            if(not run.check(not rmq.is_alive(history[i].first) and rmq.size(history[i].first) == 0, "release"))
+                return false;
+            history.erase(history.begin() + static_cast<std::ptrdiff_t>(i));
+            break;
+        }
+        default:
+        {
+            const std::pair<tree_t::version_t, std::vector<int> >& old = history[gen() % history.size()];
+            const std::vector<int>& expected = old.second;
+            const std::pair<uint32_t,uint32_t> range = random_range(gen, expected.size());
+            if(not run.check(rmq.is_alive(old.first) and rmq.size(old.first) == expected.size(), "size of a version"))
+                return false;
+            if(not run.check(rmq.query(old.first, range.first, range.second) == naive<rmq_min<int> >(expected, range.first, range.second), "query of a version"))
+                return false;
+            if(range.first < range.second and not run.check(rmq.access(old.first, range.first) == expected[range.first], "access of a version"))
+                return false;
+            if(gen() % 16 == 0 and not run.check(rmq.to_vector(old.first) == expected, "to_vector of a version"))
+                return false;
+            break;
+        }
+        }
+        if(edited)
+            history.push_back(std::make_pair(rmq.latest(), std::move(vec)));
+        // Only the last keep versions are alive.
+        while(history.front().first + keep <= rmq.latest())
+        {
+            if(not run.check(not rmq.is_alive(history.front().first), "window of the versions"))
+                return false;
+            history.pop_front();
+        }
+    }
+    return run.check(rmq.to_vector(rmq.latest()) == history.back().second, "to_vector");
+}
+
+/*!
+ * Random edits of concurrent_avl_rmq, while up to max_snapshots snapshots are
+ * kept alive and compared with the copies of the array taken with them. Once
+ * all the snapshots are dropped, the next write reclaims all the replaced
+ * nodes.
+ * @return false on a mismatch.
+ */
+static bool run_concurrent(uint64_t seed, size_t steps)
+{
+    typedef concurrent_avl_rmq<uint32_t,int> tree_t;
+    static const size_t max_snapshots = 8;
+    gen_t gen(seed);
+    run_t run = {seed, "concurrent_avl_rmq", 0};
+    tree_t rmq;
+    std::vector<int> vec;
+    std::deque<tree_t::snapshot_t> snapshots;
+    std::deque< std::vector<int> > copies;
+    for(; run.step < steps; ++run.step)
+    {
+        switch(gen() % 8)
+        {
+        case 0:
+        {
+            if(snapshots.size() == max_snapshots)
+            {
+                snapshots.pop_front();
+                copies.pop_front();
+            }
+            snapshots.push_back(rmq.snapshot());
+            copies.push_back(vec);
+            break;
+        }
+        case 1:
+        {
+            if(snapshots.empty())
+                break;
+            const size_t i = gen() % snapshots.size();
+            const std::vector<int>& expected = copies[i];
+            const std::pair<uint32_t,uint32_t> range = random_range(gen, expected.size());
+            if(not run.check(snapshots[i].size() == expected.size(), "size of a snapshot"))
+                return false;
+            if(not run.check(snapshots[i](range.first, range.second) == naive<rmq_min<int> >(expected, range.first, range.second), "query of a snapshot"))
+                return false;
+            if(range.first < range.second and not run.check(snapshots[i][range.first] == expected[range.first], "access of a snapshot"))
+                return false;
+            if(gen() % 16 == 0 and not run.check(snapshots[i].to_vector() == expected, "to_vector of a snapshot"))
+                return false;
+            break;
+        }
+        case 2:
+        {
+            if(gen() % 16 != 0)
+                break;
+            snapshots.clear();
+            copies.clear();
+            rmq.reclaim();
+            if(not run.check(rmq.pending() == 0, "reclaim"))
+                return false;
+            break;
+        }
+        default:
+            if(not basic_step<true>(rmq, vec, gen, run))
+                return false;
+            break;
+        }
+        if(run.step % check_every == 0 and not run.check(rmq.size() == vec.size() and rmq.snapshot().to_vector() == vec, "to_vector"))
+            return false;
+    }
+    return run.check(rmq.snapshot().to_vector() == vec, "to_vector");
+}
+
+/*!
+ * Random insertions and deletions at both ends of sliding_window_rmq, and
+ * queries of arbitrary intervals, that span both stacks.
+ * @return false on a mismatch.
+ */
+template< typename Op>
+static bool run_window(const char* name, uint64_t seed, size_t steps)
+{
+    gen_t gen(seed);
+    run_t run = {seed, name, 0};
+    sliding_window_rmq<uint32_t,int,Op> rmq;
+    std::vector<int> vec;
+    for(; run.step < steps; ++run.step)
+    {
+        const size_t n = vec.size();
+        const int value = static_cast<int>(gen() % max_value);
+        switch(gen() % 10)
+        {
+        case 0:
+            if(n >= max_size)
+                break;
+            rmq.push_back(value);
+            vec.push_back(value);
+            break;
+        case 1:
+            if(n >= max_size)
+                break;
+            rmq.push_front(value);
+            vec.insert(vec.begin(), value);
+            break;
+        case 2:
+            if(n == 0)
+                break;
+            rmq.pop_front();
+            vec.erase(vec.begin());
+            break;
+        case 3:
+            if(n == 0)
+                break;
+            rmq.pop_back();
+            vec.pop_back();
+            break;
+        case 4:
+        {
+            if(n == 0)
+                break;
+            const uint32_t rank = static_cast<uint32_t>(gen() % n);
+            if(not run.check(rmq[rank] == vec[rank] and rmq.front() == vec.front() and rmq.back() == vec.back(), "access"))
+                return false;
+            break;
+        }
+        case 5:
+            if(gen() % 64 == 0)
+                rmq.build(vec.begin(), vec.end());
+            break;
+        default:
+        {
+            const std::pair<uint32_t,uint32_t> range = random_range(gen, n);
+            if(not run.check(rmq(range.first, range.second) == naive<Op>(vec, range.first, range.second), "operator()"))
+                return false;
+            break;
+        }
+        }
+        if(run.step % check_every == 0 and not content_check(rmq, vec, run))
+            return false;
+    }
+    return content_check(rmq, vec, run);
+}
+
+/*!
+ * Bursts of random edits of async_rmq, applied by its background thread in
+ * batches of at most max_batch edits. Some bursts have increasing ranks, that
+ * are applied with insert_batch and update_batch. The array is compared after
+ * flush(), or with query(seq, ...) after the last edit of the burst.
+ * @return false on a mismatch.
+ */
+static bool run_async(size_t max_batch, const char* name, uint64_t seed, size_t steps)
+{
+    gen_t gen(seed);
+    run_t run = {seed, name, 0};
+    async_rmq<uint32_t,int> rmq(max_batch);
+    std::vector<int> vec;
+    for(; run.step < steps; ++run.step)
+    {
+        const size_t m = 1 + gen() % 32;
+        const bool sorted = gen() % 2 == 0;
+        uint32_t rank = 0;
+        uint64_t seq = 0;
+        for(size_t i = 0; i < m; ++i)
+        {
+            const size_t n = vec.size();
+            const int value = static_cast<int>(gen() % max_value);
+            if(sorted)
+                rank = std::min<uint32_t>(rank + static_cast<uint32_t>(gen() % 4), static_cast<uint32_t>(n));
+            else
+                rank = static_cast<uint32_t>(gen() % (n + 1));
+            if((gen() % 2 == 0 or rank == n) and n < max_size)
+            {
+                seq = rmq.insert(rank, value);
+                vec.insert(vec.begin() + rank, value);
+            }
+            else if(rank < n)
+            {
+                seq = rmq.update(rank, value);
+                vec[rank] = value;
+            }
+        }
+
+        const std::pair<uint32_t,uint32_t> range = random_range(gen, vec.size());
+        if(gen() % 2 == 0 and seq > 0)
+        {
+            if(not run.check(rmq.query(seq, range.first, range.second) == naive<rmq_min<int> >(vec, range.first, range.second), "query(seq)"))
+                return false;
+            continue;
+        }
+        rmq.flush();
+        if(not run.check(rmq(range.first, range.second) == naive<rmq_min<int> >(vec, range.first, range.second), "operator() after flush"))
+            return false;
+        if(range.first < range.second and not run.check(rmq[range.first] == vec[range.first], "operator[] after flush"))
+            return false;
+        if(run.step % check_every == 0 and not content_check(rmq, vec, run))
+            return false;
+    }
+    rmq.flush();
+    return content_check(rmq, vec, run);
+}
+
+/*!
+ * Serialize avl_rmq trees of random arrays, with more than one block of the
+ * image each, and compare the queries and the accesses of mapped_rmq, and the
+ * content of the tree read back by load, with the arrays. The image is 
+ * written under $TMPDIR, /tmp by default, and removed at the end.
+ * @return false on a mismatch.
+ */
+template< typename Op>
+static bool run_mapped(const char* name, uint64_t seed, size_t rounds)
+{
+    const char* tmp = std::getenv("TMPDIR");
+    const std::string path = std::string(tmp != nullptr ? tmp : "/tmp") + "/avl_rmq_stress_test_" + std::to_string(seed) + ".bin";
+    const size_t queries = 256;
+    gen_t gen(seed);
+    run_t run = {seed, name, 0};
+    bool ok = true;
+    for(; ok and run.step < rounds; ++run.step)
+    {
+        std::vector<int> vec(rmq_image_header::default_block + 1 + gen() % (max_size - rmq_image_header::default_block));
+        for(size_t i = 0; i < vec.size(); ++i)
+            vec[i] = static_cast<int>(gen() % max_value);
+        avl_rmq<uint32_t,int,Op> rmq(vec.begin(), vec.end());
+        {
+            std::ofstream out(path, std::ios::binary);
+            ok = run.check(rmq.serialize(out), "serialize");
+        }
+
+        mapped_rmq<uint32_t,int,Op> mapped(path.c_str());
+        ok = ok and run.check(mapped.is_open() and mapped.size() == vec.size(), "open");
+        // The image is rejected by mapped_rmq with another aggregate.
+        ok = ok and run.check(not mapped_rmq<uint32_t,int,rmq_max<int> >(path.c_str()).is_open(), "aggregate");
+        for(size_t q = 0; ok and q < queries; ++q)
+        {
+            const std::pair<uint32_t,uint32_t> range = random_range(gen, vec.size());
+            ok = run.check(mapped(range.first, range.second) == naive<Op>(vec, range.first, range.second), "operator()");
+            if(ok and range.first < range.second)
+                ok = run.check(mapped[range.first] == vec[range.first], "operator[]");
+        }
+
+        avl_rmq<uint32_t,int,Op> loaded;
+        {
+            std::ifstream in(path, std::ios::binary);
+            ok = ok and run.check(loaded.load(in) and loaded.check_integrity() and loaded.to_vector() == vec, "load");
+        }
+    }
+    std::remove(path.c_str());
+    return ok;
+}
+
+int main(int argc, char *const argv[])
+{
+    const uint64_t seed = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 42;
+    const size_t steps = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 200000;
+
+    compact_avl_rmq<uint32_t,int> compact;
+    // Small nodes, so that the B-tree has several levels.
+    btree_rmq<uint32_t,int,4> narrow_btree;
+    btree_rmq<uint32_t,int> btree;
+    // Small blocks, so that the blocks are split and merged often.
+    bucket_avl_rmq<uint32_t,int,8> narrow_bucket;
+    bucket_avl_rmq<uint32_t,int> bucket;
+
+    if(not run_avl(seed, steps) or
+        not run_lazy(seed, steps) or
+        not run_basic<false>(compact, "compact_avl_rmq", seed, steps) or
+        not run_basic<false>(narrow_btree, "btree_rmq<4>", seed, steps) or
+        not run_basic<false>(btree, "btree_rmq", seed, steps) or
+        not run_basic<true>(narrow_bucket, "bucket_avl_rmq<8>", seed, steps) or
+        not run_basic<true>(bucket, "bucket_avl_rmq", seed, steps) or
+        not run_sharded(seed, steps / 4) or
+        not run_persistent(seed, steps) or
+        not run_concurrent(seed, steps) or
+        not run_window<rmq_min<int> >("sliding_window_rmq", seed, steps) or
+        not run_window<hash_op>("sliding_window_rmq with hash_op", seed, steps) or
+        not run_async(8, "async_rmq with batches of 8", seed, steps / 32) or
+        not run_async(1 << 12, "async_rmq", seed, steps / 32) or
+        not run_mapped<rmq_min<int> >("mapped_rmq", seed, steps / 1000) or
+        not run_mapped<rmq_sum<int,long> >("mapped_rmq with rmq_sum", seed, steps / 1000))
+        return 1;
+
+    std::cout << "Passed " << steps << " steps with seed " << seed << std::endl;
+    return 0;
+}
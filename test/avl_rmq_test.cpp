@@ -34,6 +34,7 @@
 */
 
 #include <iostream>
+#include <string>
 #include <avl_rmq.hpp>
 #include <malloc_count.h>
 
@@ -62,6 +63,131 @@ int main(int argc, char *const argv[])
     std::cout << "Min in arr[1..3) is " << avl(1,3) << std::endl; // 2
     std::cout << "Min in arr[6..12) is " << avl(6,12) << std::endl; // 3
     std::cout << "Value at arr[1] is " << avl[1] << std::endl; // 2
+    std::cout << "Argmin in arr[1..6) is " << avl.argmin(1,6) << std::endl; // 3
+    std::pair<int,int> mp = avl.min_with_pos(4,13);
+    std::cout << "Min in arr[4..13) is " << mp.first << " at " << mp.second << std::endl; // 2 at 5
+    std::cout << "First value below 3 from arr[4] is at " << avl.find_first_below(4,3) << std::endl; // 5
+    std::cout << "Last value below 2 up to arr[12] is at " << avl.find_last_below(12,2) << std::endl; // 3
+
+    std::vector<int> vec(freq, freq + n);
+    avl_rmq<int,int> built(vec);
+    built.print();
+
+    std::cout << "Min in arr[1..3) is " << built(1,3) << std::endl; // 1
+    std::cout << "Min in arr[3..7) is " << built(3,7) << std::endl; // 2
+
+    built.erase(2);
+    built.print(); // 2 1 3 2 3 4 5 6 7 8 9
+
+    built.erase(0,3);
+    built.print(); // 2 3 4 5 6 7 8 9
+
+    std::cout << "Min in arr[1..3) is " << built(1,3) << std::endl; // 3
+
+    auto parts = built.split(3);
+    parts.first.print(); // 2 3 4
+    parts.second.print(); // 5 6 7 8 9
+
+    avl_rmq<int,int> joined = avl_rmq<int,int>::join(std::move(parts.second), std::move(parts.first));
+    joined.print(); // 5 6 7 8 9 2 3 4
+
+    std::cout << "Min in arr[3..6) is " << joined(3,6) << std::endl; // 2
+
+    std::vector<int> large(1 << 18);
+    for(size_t i = 0; i < large.size(); ++i)
+        large[i] = static_cast<int>((i * 7919) % large.size());
+    avl_rmq<int,int> parallel;
+    parallel.build(large.begin(), large.end(), 4);
+    std::cout << "Parallel build and to_vector match: " << (parallel.to_vector(4) == large) << std::endl; // 1
+    std::cout << "Min in arr[1..1000) is " << parallel(1,1000) << std::endl; // 64
+
+    parallel.freeze();
+    std::cout << "Min in arr[1..1000) of the frozen array is " << parallel(1,1000) << std::endl; // 64
+    parallel.update(parallel.argmin(1,1000), 100000);
+    std::cout << "Frozen after the update: " << parallel.is_frozen() << std::endl; // 0
+    std::cout << "Min in arr[1..1000) is " << parallel(1,1000) << std::endl; // 315
+
+    std::pair<int,int> ranges[] = {{0, 3}, {3, 6}, {5, 8}};
+    int mins[3];
+    joined.query_batch(ranges, 3, mins);
+    std::cout << "Mins in arr[0..3), arr[3..6), arr[5..8) are " << mins[0] << " " << mins[1] << " " << mins[2] << std::endl; // 5 2 2
+
+    std::pair<int,int> inserts[] = {{0, 1}, {3, 0}, {3, 4}};
+    joined.insert_batch(inserts, 3);
+    joined.print(); // 1 5 6 7 0 4 8 9 2 3 4
+
+    std::pair<int,int> updates[] = {{0, 10}, {4, 10}};
+    joined.update_batch(updates, 2);
+    joined.print(); // 10 5 6 7 10 4 8 9 2 3 4
+
+    avl_rmq<int,int,rmq_max<int> > max_avl(vec);
+    std::cout << "Max in arr[1..5) is " << max_avl(1,5) << std::endl; // 3
+    std::cout << "Argmax in arr[1..7) is " << max_avl.argmin(1,7) << std::endl; // 6
+
+    avl_rmq<int,int,rmq_sum<int,long> > sum_avl(vec);
+    std::cout << "Sum of arr[1..5) is " << sum_avl(1,5) << std::endl; // 7
+
+    avl_rmq<int,int,rmq_fuse<rmq_min_count<int>, rmq_sum<int> > > fused_avl(vec);
+    auto fused = fused_avl(0,5);
+    std::cout << "Min in arr[0..5) is " << fused.first.first << " with " << fused.first.second << " occurrences, and the sum is " << fused.second << std::endl; // 1 with 2 occurrences, and the sum is 9
+
+    avl_rmq<int,int,rmq_lazy<rmq_fuse<rmq_min<int>, rmq_sum<int> > > > lazy_avl(vec);
+    lazy_avl.range_add(0,6,10);
+    lazy_avl.print(); // 12 11 11 13 12 13 4 5 6 7 8 9
+    lazy_avl.range_assign(2,8,1);
+    lazy_avl.print(); // 12 11 1 1 1 1 1 1 6 7 8 9
+    auto lazy = lazy_avl(1,9);
+    std::cout << "Min in arr[1..9) is " << lazy.first << " and the sum is " << lazy.second << std::endl; // 1 and the sum is 23
+
+    // The values are stored in 16 bits, while the interface uses 64 bits.
+    avl_rmq<uint32_t,uint64_t,rmq_min<uint64_t,uint16_t> > narrow_avl(vec.begin(), vec.end());
+    narrow_avl.insert(3, 40000);
+    narrow_avl.print(); // 2 1 1 40000 3 2 3 4 5 6 7 8 9
+    std::cout << "Min in arr[3..5) is " << narrow_avl(3,5) << std::endl; // 3
+    std::cout << "Node of 16 bit values is smaller: " << (sizeof(avl_rmq<uint32_t,uint64_t,rmq_min<uint64_t,uint16_t> >::node_t) < sizeof(avl_rmq<uint32_t,uint64_t>::node_t)) << std::endl; // 1
+
+
+    narrow_avl.compact();
+    narrow_avl.print(); // 2 1 1 40000 3 2 3 4 5 6 7 8 9
+    narrow_avl.set_prefetch(true);
+    std::cout << "Min in arr[1..4) with prefetching is " << narrow_avl(1,4) << std::endl; // 1
+    std::cout << "Value at arr[3] with prefetching is " << narrow_avl[3] << std::endl; // 40000
+
+
+    avl_rmq<int,int,rmq_min<int>,rmq_stats> stats_avl;
+    for(int i = 0; i < n; ++i)
+        stats_avl.insert(i,freq[i]);
+    stats_avl(2,9);
+    stats_avl.erase(0);
+    std::cout << "Number of insertions is " << stats_avl.get_stats().count(RMQ_INSERT) << std::endl; // 12
+    std::cout << "Number of rotations is " << stats_avl.get_stats().n_rotations() << std::endl; // 8
+    std::cout << "Nodes visited by the query " << stats_avl.get_stats().visited(RMQ_QUERY) << std::endl; // 6
+    std::cout << "Memory of the nodes is " << stats_avl.memory_usage().nodes << " bytes" << std::endl; // 352
+    stats_avl.erase(0,3);
+    std::cout << "Elements erased by ranges is " << stats_avl.get_stats().elements(RMQ_ERASE_RANGE) << std::endl; // 3
+    stats_avl.get_stats().print();
+
+
+    // The values are constructed in place, moved and updated through [].
+    avl_rmq<uint32_t,std::string,rmq_max<std::string> > words;
+    words.emplace(0, size_t(3), 'b');
+    words.insert(0, std::string("abc"));
+    words.emplace(1, "zz");
+    std::string word = "cat";
+    words.insert(3, std::move(word));
+    words.print(); // abc zz bbb cat
+    std::cout << "Max in arr[0..2) is " << words(0,2) << std::endl; // zz
+    words[1] = "a";
+    std::cout << "Max in arr[0..2) is " << words(0,2) << std::endl; // abc
+    std::cout << "Value at arr[2] is " << words.at(2) << std::endl; // bbb
+
+
+    std::cout << "Values in arr[1..3) are";
+    words.for_each(1, 3, [](const std::string& w) { std::cout << " " << w; });
+    std::cout << std::endl; // a bbb
+    for(auto it = words.iterator_at(2); it != words.end(); ++it)
+        std::cout << *it << " ";
+    std::cout << std::endl; // bbb cat
     
     return 0;
 }
\ No newline at end of file
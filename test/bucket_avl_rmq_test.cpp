@@ -0,0 +1,75 @@
+////////////////////////////////////////////////////////////////////////////////
+// bucket_avl_rmq_test.cpp
+//   Test the rmq AVL of blocks.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Massimiliano Rossi
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+/*!
+   \file bucket_avl_rmq_test.cpp
+   \brief bucket_avl_rmq_test.cpp Test the rmq AVL of blocks.
+   \author Massimiliano Rossi
+   \date 20/10/2021
+*/
+
+#include <iostream>
+#include <bucket_avl_rmq.hpp>
+#include <malloc_count.h>
+
+int main(int argc, char *const argv[])
+{
+
+    int freq[] = {2, 1, 1, 3, 2, 3, 4, 5, 6, 7, 8, 9};
+    int n = sizeof(freq)/sizeof(freq[0]);
+
+    // Small blocks, so that the example splits and merges blocks
+    bucket_avl_rmq<uint32_t,int,4> avl;
+
+    for(int i = 0; i < n; ++i)
+        avl.insert(static_cast<uint32_t>(i),freq[i]);
+
+    avl.print(); // 2 1 1 3 2 3 4 5 6 7 8 9
+
+    std::cout << "Min in arr[1..3) is " << avl(1,3) << std::endl; // 1
+    std::cout << "Min in arr[3..7) is " << avl(3,7) << std::endl; // 2
+
+    avl.insert(0,12);
+    avl.update(2,12);
+    avl.print(); // 12 2 12 1 3 2 3 4 5 6 7 8 9
+
+    std::cout << "Min in arr[1..3) is " << avl(1,3) << std::endl; // 2
+    std::cout << "Min in arr[6..12) is " << avl(6,12) << std::endl; // 3
+    std::cout << "Value at arr[1] is " << avl[1] << std::endl; // 2
+
+    for(int i = 0; i < 9; ++i)
+        avl.erase(1);
+    avl.print(); // 12 7 8 9
+    std::cout << "Number of blocks is " << avl.n_blocks() << std::endl; // 2
+
+    std::vector<int> vec(freq, freq + n);
+    bucket_avl_rmq<uint32_t,int> built(vec.begin(), vec.end());
+    std::cout << "Min in arr[3..7) is " << built(3,7) << std::endl; // 2
+
+    return 0;
+}
@@ -0,0 +1,109 @@
+////////////////////////////////////////////////////////////////////////////////
+// concurrent_avl_rmq_test.cpp
+//   Test the rmq AVL with lock-free readers.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Massimiliano Rossi
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+/*!
+   \file concurrent_avl_rmq_test.cpp
+   \brief concurrent_avl_rmq_test.cpp Test the rmq AVL with lock-free readers.
+   \author Massimiliano Rossi
+   \date 20/10/2021
+*/
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <concurrent_avl_rmq.hpp>
+#include <malloc_count.h>
+
+int main(int argc, char *const argv[])
+{
+
+    int freq[] = {2, 1, 1, 3, 2, 3, 4, 5, 6, 7, 8, 9};
+    int n = sizeof(freq)/sizeof(freq[0]);
+
+    concurrent_avl_rmq<uint32_t,int> avl;
+
+    for(int i = 0; i < n; ++i)
+        avl.insert(static_cast<uint32_t>(i),freq[i]);
+
+    avl.print(); // 2 1 1 3 2 3 4 5 6 7 8 9
+
+    std::cout << "Min in arr[1..3) is " << avl(1,3) << std::endl; // 1
+    std::cout << "Min in arr[3..7) is " << avl(3,7) << std::endl; // 2
+
+    {
+        // The snapshot is not affected by the following writes.
+        auto snapshot = avl.snapshot();
+
+        avl.insert(0,12);
+        avl.update(2,12);
+        avl.erase(12);
+        avl.print(); // 12 2 12 1 3 2 3 4 5 6 7 8
+
+        std::cout << "Min in arr[1..3) is " << avl(1,3) << std::endl; // 2
+        std::cout << "Min in arr[1..3) of the snapshot is " << snapshot(1,3) << std::endl; // 1
+        std::cout << "Value at arr[0] of the snapshot is " << snapshot[0] << std::endl; // 2
+    }
+
+    // Readers query snapshots while the writer appends values.
+    std::atomic<bool> done(false);
+    std::atomic<size_t> errors(0);
+    std::vector<std::thread> readers;
+    for(int r = 0; r < 4; ++r)
+        readers.emplace_back([&avl, &done, &errors]()
+        {
+            while(not done.load())
+            {
+                auto snapshot = avl.snapshot();
+                std::vector<int> vec = snapshot.to_vector();
+                int min = std::numeric_limits<int>::max();
+                for(size_t i = vec.size(); i > 0; --i)
+                {
+                    min = std::min(min, vec[i - 1]);
+                    if(snapshot(static_cast<uint32_t>(i - 1), snapshot.size()) != min)
+                        errors++;
+                }
+            }
+        });
+
+    for(int i = 0; i < 10000; ++i)
+    {
+        avl.insert(avl.size(), i % 100);
+        if(avl.size() > 1000)
+            avl.erase(0);
+    }
+    done.store(true);
+    for(size_t r = 0; r < readers.size(); ++r)
+        readers[r].join();
+
+    avl.reclaim();
+    std::cout << "Errors of the readers: " << errors.load() << std::endl; // 0
+    std::cout << "Nodes not reclaimed: " << avl.pending() << std::endl; // 0
+    
+    return 0;
+}
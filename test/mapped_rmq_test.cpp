@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////////////
+// mapped_rmq_test.cpp
+//   Test the serialization and the memory mapped rmq.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Massimiliano Rossi
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+/*!
+   \file mapped_rmq_test.cpp
+   \brief mapped_rmq_test.cpp Test the serialization and the memory mapped rmq.
+   \author Massimiliano Rossi
+   \date 20/10/2021
+*/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <avl_rmq.hpp>
+#include <mapped_rmq.hpp>
+#include <malloc_count.h>
+
+int main(int argc, char *const argv[])
+{
+
+    int freq[] = {2, 1, 1, 3, 2, 3, 4, 5, 6, 7, 8, 9};
+    int n = sizeof(freq)/sizeof(freq[0]);
+
+    avl_rmq<uint32_t,int> avl;
+
+    for(int i = 0; i < n; ++i)
+        avl.insert(static_cast<uint32_t>(i),freq[i]);
+
+    avl.insert(0,12);
+    avl.update(2,12);
+    avl.print(); // 12 2 12 1 3 2 3 4 5 6 7 8 9
+
+    const char* tmp = std::getenv("TMPDIR");
+    const std::string image = std::string(tmp != nullptr ? tmp : "/tmp") + "/mapped_rmq_test.bin";
+    const char* path = image.c_str();
+    {
+        std::ofstream out(path, std::ios::binary);
+        std::cout << "Serialized: " << avl.serialize(out) << std::endl; // 1
+    }
+
+    avl_rmq<uint32_t,int> loaded;
+    {
+        std::ifstream in(path, std::ios::binary);
+        std::cout << "Loaded: " << loaded.load(in) << std::endl; // 1
+    }
+    loaded.print(); // 12 2 12 1 3 2 3 4 5 6 7 8 9
+
+    std::cout << "Min in arr[1..3) is " << loaded(1,3) << std::endl; // 2
+    std::cout << "Min in arr[6..12) is " << loaded(6,12) << std::endl; // 3
+
+    mapped_rmq<uint32_t,int> mapped(path);
+    std::cout << "Mapped: " << mapped.is_open() << std::endl; // 1
+
+    std::cout << "Min in arr[1..3) is " << mapped(1,3) << std::endl; // 2
+    std::cout << "Min in arr[6..12) is " << mapped(6,12) << std::endl; // 3
+    std::cout << "Value at arr[1] is " << mapped[1] << std::endl; // 2
+
+    mapped_rmq<uint32_t,long> wrong(path);
+    std::cout << "Mapped with the wrong type: " << wrong.is_open() << std::endl; // 0
+    wrong.close();
+    mapped_rmq<uint32_t,int,rmq_max<int> > wrong_agg(path);
+    std::cout << "Mapped with the wrong aggregate: " << wrong_agg.is_open() << std::endl; // 0
+    wrong_agg.close();
+    {
+        avl_rmq<uint32_t,int,rmq_max<int> > max_loaded;
+        std::ifstream in(path, std::ios::binary);
+        std::cout << "Loaded with the wrong aggregate: " << max_loaded.load(in) << std::endl; // 0
+    }
+    mapped.close();
+
+    // Corrupt the number of values, leaving the offsets untouched.
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        rmq_image_header header;
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        header.n = 100000000;
+        file.seekp(0);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    mapped_rmq<uint32_t,int> corrupted(path);
+    std::cout << "Mapped with a corrupted header: " << corrupted.is_open() << std::endl; // 0
+    {
+        std::ifstream in(path, std::ios::binary);
+        std::cout << "Loaded with a corrupted header: " << loaded.load(in) << " " << loaded.size() << std::endl; // 0 0
+    }
+
+    std::remove(path);
+    return 0;
+}
@@ -0,0 +1,79 @@
+////////////////////////////////////////////////////////////////////////////////
+// persistent_avl_rmq_test.cpp
+//   Test the persistent rmq AVL.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Massimiliano Rossi
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+/*!
+   \file persistent_avl_rmq_test.cpp
+   \brief persistent_avl_rmq_test.cpp Test the persistent rmq AVL.
+   \author Massimiliano Rossi
+   \date 20/10/2021
+*/
+
+#include <iostream>
+#include <persistent_avl_rmq.hpp>
+#include <malloc_count.h>
+
+int main(int argc, char *const argv[])
+{
+
+    int freq[] = {2, 1, 1, 3, 2, 3, 4, 5, 6, 7, 8, 9};
+    int n = sizeof(freq)/sizeof(freq[0]);
+
+    persistent_avl_rmq<uint32_t,int> avl;
+
+    for(int i = 0; i < n; ++i)
+        avl.insert(static_cast<uint32_t>(i),freq[i]);
+
+    const persistent_avl_rmq<uint32_t,int>::version_t before = avl.latest();
+    avl.print(before); // 2 1 1 3 2 3 4 5 6 7 8 9
+
+    avl.insert(0,12);
+    avl.update(2,12);
+    avl.erase(12);
+    avl.print(avl.latest()); // 12 2 12 1 3 2 3 4 5 6 7 8
+
+    std::cout << "Min in arr[1..3) is " << avl(1,3) << std::endl; // 2
+    std::cout << "Min in arr[1..3) of version " << before << " is " << avl.query(before,1,3) << std::endl; // 1
+    std::cout << "Value at arr[0] of version " << before << " is " << avl.access(before,0) << std::endl; // 2
+    std::cout << "Size of version 5 is " << avl.size(5) << std::endl; // 5
+
+    // Releasing the old versions frees the nodes they do not share.
+    for(persistent_avl_rmq<uint32_t,int>::version_t v = 0; v < avl.latest(); ++v)
+        avl.release(v);
+    std::cout << "Nodes after the release: " << avl.n_nodes() << std::endl; // 12
+
+    // Keep only the last 10 versions.
+    persistent_avl_rmq<uint32_t,int> window(10);
+    for(int i = 0; i < 10000; ++i)
+        window.insert(window.size(), i % 100);
+    std::cout << "Version 9990 is alive: " << window.is_alive(9990) << std::endl; // 0
+    std::cout << "Version 9991 is alive: " << window.is_alive(9991) << std::endl; // 1
+    std::cout << "Min in arr[0..50) of version 9991 is " << window.query(9991,0,50) << std::endl; // 0
+    std::cout << "Size of version 9991 is " << window.size(9991) << std::endl; // 9991
+
+    return 0;
+}
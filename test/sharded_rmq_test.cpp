@@ -0,0 +1,76 @@
+////////////////////////////////////////////////////////////////////////////////
+// sharded_rmq_test.cpp
+//   Test the sharded rmq.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Massimiliano Rossi
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+/*!
+   \file sharded_rmq_test.cpp
+   \brief sharded_rmq_test.cpp Test the sharded rmq.
+   \author Massimiliano Rossi
+   \date 20/10/2021
+*/
+
+#include <iostream>
+#include <vector>
+#include <sharded_rmq.hpp>
+#include <malloc_count.h>
+
+int main(int argc, char *const argv[])
+{
+
+    int freq[] = {2, 1, 1, 3, 2, 3, 4, 5, 6, 7, 8, 9};
+    int n = sizeof(freq)/sizeof(freq[0]);
+
+    sharded_rmq<uint32_t,int> rmq(3);
+    rmq.build(freq, freq + n);
+    rmq.print(); // 2 1 1 3 2 3 4 5 6 7 8 9
+
+    std::cout << "Min in arr[1..3) is " << rmq(1,3) << std::endl; // 1
+    std::cout << "Min in arr[3..11) is " << rmq(3,11) << std::endl; // 2
+    std::cout << "Min in arr[5..12) is " << rmq(5,12) << std::endl; // 3
+
+    rmq.insert(0,12);
+    rmq.update(2,12);
+    rmq.erase(12);
+    rmq.print(); // 12 2 12 1 3 2 3 4 5 6 7 8
+
+    std::pair<uint32_t,int> updates[] = {{1, 9}, {3, 9}, {10, 0}};
+    rmq.update_batch(updates, 3);
+    rmq.print(); // 12 9 12 9 3 2 3 4 5 6 0 8
+
+    std::pair<uint32_t,uint32_t> ranges[] = {{0, 4}, {2, 10}, {0, 12}};
+    int mins[3];
+    rmq.query_batch(ranges, 3, mins);
+    std::cout << "Mins in arr[0..4), arr[2..10), arr[0..12) are " << mins[0] << " " << mins[1] << " " << mins[2] << std::endl; // 9 2 0
+
+    // Appending to the last shard triggers the rebalance.
+    for(int i = 0; i < 100000; ++i)
+        rmq.insert(rmq.size(), i % 1000 + 10);
+    std::cout << "Size of the first shard is " << rmq.shard_size(0) << std::endl; // 31872
+    std::cout << "Min in arr[12..100012) is " << rmq(12,100012) << std::endl; // 10
+
+    return 0;
+}
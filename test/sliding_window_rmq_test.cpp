@@ -0,0 +1,73 @@
+////////////////////////////////////////////////////////////////////////////////
+// sliding_window_rmq_test.cpp
+//   Test the rmq double ended queue.
+////////////////////////////////////////////////////////////////////////////////
+// Copyright (c) 2021 Massimiliano Rossi
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+////////////////////////////////////////////////////////////////////////////////
+
+/*!
+   \file sliding_window_rmq_test.cpp
+   \brief sliding_window_rmq_test.cpp Test the rmq double ended queue.
+   \author Massimiliano Rossi
+   \date 20/10/2021
+*/
+
+#include <iostream>
+#include <sliding_window_rmq.hpp>
+#include <malloc_count.h>
+
+int main(int argc, char *const argv[])
+{
+
+    int freq[] = {2, 1, 1, 3, 2, 3, 4, 5, 6, 7, 8, 9};
+    int n = sizeof(freq)/sizeof(freq[0]);
+
+    sliding_window_rmq<uint32_t,int> window(freq, freq + n);
+    window.print(); // 2 1 1 3 2 3 4 5 6 7 8 9
+
+    std::cout << "Min in arr[1..3) is " << window(1,3) << std::endl; // 1
+    std::cout << "Min in arr[3..7) is " << window(3,7) << std::endl; // 2
+
+    // Slide the window by three values.
+    for(int i = 0; i < 3; ++i)
+    {
+        window.push_back(10 + i);
+        window.pop_front();
+    }
+    window.print(); // 3 2 3 4 5 6 7 8 9 10 11 12
+    std::cout << "Min of the window is " << window(0,window.size()) << std::endl; // 2
+    std::cout << "Min in arr[2..12) is " << window(2,12) << std::endl; // 3
+
+    window.push_front(0);
+    window.pop_back();
+    window.print(); // 0 3 2 3 4 5 6 7 8 9 10 11
+    std::cout << "Value at arr[2] is " << window[2] << std::endl; // 2
+    std::cout << "First and last values are " << window.front() << " " << window.back() << std::endl; // 0 11
+
+    sliding_window_rmq<uint32_t,int,rmq_sum<int,long> > sums(freq, freq + n);
+    sums.pop_front();
+    std::cout << "Sum of arr[0..4) is " << sums(0,4) << std::endl; // 7
+
+    return 0;
+}